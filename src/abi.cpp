@@ -0,0 +1,186 @@
+#include "abi.hpp"
+
+#include <llvm/IR/DataLayout.h>
+#include <llvm/TargetParser/Triple.h>
+
+#include <algorithm>
+#include <optional>
+#include <utility>
+
+namespace FoxLang::IR {
+// what an eightbyte of a struct holds, an integer beats SSE when it has both
+enum class Class { None, Integer, SSE };
+
+// every scalar in `type` with its offset, vectors count as one
+static void leaves(const llvm::DataLayout &layout, llvm::Type *type,
+				   uint64_t offset,
+				   std::vector<std::pair<uint64_t, llvm::Type *>> &out) {
+	if (auto s = llvm::dyn_cast<llvm::StructType>(type)) {
+		auto fields = layout.getStructLayout(s);
+		for (unsigned i = 0; i < s->getNumElements(); i++)
+			leaves(layout, s->getElementType(i),
+				   offset + fields->getElementOffset(i), out);
+		return;
+	}
+	if (auto a = llvm::dyn_cast<llvm::ArrayType>(type)) {
+		auto size = layout.getTypeAllocSize(a->getElementType());
+		for (uint64_t i = 0; i < a->getNumElements(); i++)
+			leaves(layout, a->getElementType(), offset + i * size, out);
+		return;
+	}
+	out.emplace_back(offset, type);
+}
+
+// the registers a struct is passed in, nullopt when it goes through memory
+static std::optional<std::vector<llvm::Type *>>
+eightbytes(const llvm::DataLayout &layout, llvm::StructType *type) {
+	uint64_t size = layout.getTypeAllocSize(type);
+	if (size > 16) return std::nullopt;
+
+	std::vector<std::pair<uint64_t, llvm::Type *>> scalars;
+	leaves(layout, type, 0, scalars);
+
+	// a lone 16 byte vector or f128 fills one SSE register whole
+	if (scalars.size() == 1 && size == 16 &&
+		(scalars[0].second->isVectorTy() || scalars[0].second->isFP128Ty()))
+		return std::vector<llvm::Type *>{scalars[0].second};
+
+	Class classes[2] = {Class::None, Class::None};
+	std::vector<llvm::Type *> sse[2];
+	for (auto [offset, scalar] : scalars) {
+		uint64_t bytes = layout.getTypeStoreSize(scalar);
+		// a field out of its alignment, in a packed struct, goes to memory
+		if (offset % layout.getABITypeAlign(scalar).value() != 0)
+			return std::nullopt;
+
+		if (scalar->isIntegerTy() || scalar->isPointerTy()) {
+			for (auto e = offset / 8; e <= (offset + bytes - 1) / 8; e++)
+				classes[e] = Class::Integer;
+			continue;
+		}
+		if (bytes > 8 || (offset % 8) + bytes > 8) return std::nullopt;
+
+		auto &c = classes[offset / 8];
+		if (c == Class::None) c = Class::SSE;
+		sse[offset / 8].push_back(scalar);
+	}
+
+	auto &context = type->getContext();
+	std::vector<llvm::Type *> parts;
+	for (uint64_t e = 0; e * 8 < size; e++) {
+		if (classes[e] == Class::Integer) {
+			auto bytes = std::min<uint64_t>(8, size - e * 8);
+			parts.push_back(llvm::IntegerType::get(context, bytes * 8));
+		} else if (classes[e] == Class::SSE) {
+			// floats of one kind share the register as a vector of them
+			auto &floats = sse[e];
+			bool same = std::all_of(floats.begin(), floats.end(),
+									[&](auto t) { return t == floats[0]; });
+			if (floats.size() == 1)
+				parts.push_back(floats[0]);
+			else if (same && !floats[0]->isVectorTy())
+				parts.push_back(
+					llvm::FixedVectorType::get(floats[0], floats.size()));
+			else
+				parts.push_back(llvm::Type::getDoubleTy(context));
+		}
+	}
+	return parts;
+}
+
+static bool integer(llvm::Type *type) {
+	return type->isIntegerTy() || type->isPointerTy();
+}
+
+CallABI CallABI::classify(const llvm::Module &module, llvm::Type *result,
+						  const std::vector<llvm::Type *> &params) {
+	auto &layout = module.getDataLayout();
+	auto &context = module.getContext();
+	llvm::Triple triple(module.getTargetTriple());
+	bool sysv =
+		triple.getArch() == llvm::Triple::x86_64 && !triple.isOSWindows();
+
+	// registers left for arguments
+	int gprs = 6, sses = 8;
+
+	auto lower = [&](llvm::Type *type, bool argument) {
+		Value value;
+		value.type = type;
+		auto s = llvm::dyn_cast<llvm::StructType>(type);
+		if (s == nullptr || !s->isSized()) {
+			if (argument && integer(type))
+				gprs -= layout.getTypeSizeInBits(type) > 64 ? 2 : 1;
+			else if (argument && (type->isFloatingPointTy() ||
+								  type->isVectorTy()))
+				sses--;
+			return value;
+		}
+
+		value.align = std::max(layout.getABITypeAlign(type),
+							   argument ? llvm::Align(8) : llvm::Align(1));
+		if (!sysv) {
+			if (layout.getTypeAllocSize(type) > 16) value.pass = Pass::Memory;
+			return value;
+		}
+
+		auto parts = eightbytes(layout, s);
+		if (parts && argument) {
+			// a struct only goes in registers when all of it fits
+			int g = std::count_if(parts->begin(), parts->end(), integer);
+			int x = parts->size() - g;
+			if (g > gprs || x > sses)
+				parts = std::nullopt;
+			else
+				gprs -= g, sses -= x;
+		}
+
+		if (!parts) {
+			value.pass = Pass::Memory;
+		} else if (!parts->empty()) {
+			value.pass = Pass::Split;
+			value.parts = std::move(*parts);
+		}
+		return value;
+	};
+
+	CallABI abi;
+	abi.result = lower(result, false);
+	std::vector<llvm::Type *> lowered;
+	auto ptr = [](llvm::Type *type) { return llvm::PointerType::get(type, 0); };
+	if (abi.result.pass == Pass::Memory) {
+		lowered.push_back(ptr(result));
+		gprs--;
+	}
+
+	for (auto param : params) {
+		abi.params.push_back(lower(param, true));
+		auto &value = abi.params.back();
+		if (value.pass == Pass::Direct)
+			lowered.push_back(param);
+		else if (value.pass == Pass::Split)
+			lowered.insert(lowered.end(), value.parts.begin(),
+						   value.parts.end());
+		else
+			lowered.push_back(ptr(param));
+	}
+
+	auto returns = abi.result.pass == Pass::Memory
+					   ? llvm::Type::getVoidTy(context)
+					   : abi.returned();
+	abi.lowered = llvm::FunctionType::get(returns, lowered, false);
+	return abi;
+}
+
+unsigned CallABI::argument(size_t i) const {
+	unsigned index = result.pass == Pass::Memory;
+	for (size_t j = 0; j < i; j++)
+		index += params[j].pass == Pass::Split ? params[j].parts.size() : 1;
+	return index;
+}
+
+llvm::Type *CallABI::returned() const {
+	if (result.pass != Pass::Split) return result.type;
+	if (result.parts.size() == 1) return result.parts[0];
+	return llvm::StructType::get(result.type->getContext(), result.parts);
+}
+} // namespace FoxLang::IR
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <llvm/IR/Attributes.h>
+#include <llvm/IR/DerivedTypes.h>
+#include <llvm/IR/Module.h>
+#include <llvm/Support/Alignment.h>
+
+#include <vector>
+
+namespace FoxLang::IR {
+/// CallABI - How the arguments and the result of a function cross a call once
+/// structs are lowered. On x86-64 this is the System V classification: a
+/// struct of up to 16 bytes is split into the integer and SSE registers its
+/// eightbytes would take, anything bigger, or that no longer fits in the
+/// registers left, goes through memory. Arguments then pass a `byval` pointer
+/// to a copy, results an `sret` pointer to memory the caller provides. Other
+/// targets only send structs bigger than 16 bytes through memory and leave
+/// the rest to llvm. Everything that is not a struct is passed as it is.
+class CallABI {
+public:
+	enum class Pass {
+		// as the value itself
+		Direct,
+		// as the registers in `parts`, one per eightbyte
+		Split,
+		// as a pointer to memory holding the value
+		Memory,
+	};
+
+	struct Value {
+		Pass pass = Pass::Direct;
+		// the type before lowering
+		llvm::Type *type = nullptr;
+		std::vector<llvm::Type *> parts;
+		// of the memory a Memory value is in
+		llvm::Align align;
+	};
+
+	Value result;
+	std::vector<Value> params;
+	/// The function type once lowered
+	llvm::FunctionType *lowered = nullptr;
+
+	/// Classifies a function taking `params` and returning `result` for the
+	/// target and data layout of `module`
+	static CallABI classify(const llvm::Module &module, llvm::Type *result,
+							const std::vector<llvm::Type *> &params);
+
+	/// Index of the first lowered argument parameter `i` is passed in
+	unsigned argument(size_t i) const;
+
+	/// The type the lowered function returns a Split result as
+	llvm::Type *returned() const;
+
+	/// Puts the `sret` and `byval` attributes on `f`, which is either the
+	/// lowered function or a call to it
+	template <typename T> void annotate(T &f) const {
+		auto &context = result.type->getContext();
+		if (result.pass == Pass::Memory) {
+			f.addParamAttr(0, llvm::Attribute::getWithStructRetType(
+								  context, result.type));
+			f.addParamAttr(0, llvm::Attribute::getWithAlignment(
+								  context, result.align));
+		}
+		for (size_t i = 0; i < params.size(); i++) {
+			if (params[i].pass != Pass::Memory) continue;
+			f.addParamAttr(argument(i), llvm::Attribute::getWithByValType(
+											context, params[i].type));
+			f.addParamAttr(argument(i), llvm::Attribute::getWithAlignment(
+											context, params[i].align));
+		}
+	}
+};
+} // namespace FoxLang::IR
@@ -6,13 +6,17 @@
 namespace FoxLang {
 std::string AST::printName() const { return "unimpl"; }
 
-AST::Exec AST::exec() { return std::monostate{}; }
-
 std::vector<AST *> AST::getChildren() const {
 	std::vector<AST *> r;
 	return r;
 }
 
+const Attribute *AST::attribute(std::string_view name) const {
+	for (auto &a : attributes)
+		if (a.name == name) return &a;
+	return nullptr;
+}
+
 std::string NumberExprAST::printName() const {
 	return fmt::format("NumberExprAST ({})", value);
 }
@@ -38,6 +42,65 @@ std::vector<AST *> StructLiteralAST::getChildren() const {
 	return r;
 }
 
+std::string ArrayLiteralAST::printName() const {
+	return fmt::format("ArrayLiteralAST ({})", elements.size());
+}
+
+std::vector<AST *> ArrayLiteralAST::getChildren() const {
+	std::vector<AST *> r;
+
+	for (auto i : elements)
+		r.push_back(i.get());
+
+	return r;
+}
+
+std::vector<AST *> IndexExprAST::getChildren() const {
+	std::vector<AST *> r;
+	r.push_back(array.get());
+	r.push_back(index.get());
+	return r;
+}
+
+std::string IndexExprAST::printName() const {
+	return checked ? "Index" : "Index (unchecked)";
+}
+
+std::vector<AST *> RefExprAST::getChildren() const {
+	std::vector<AST *> r;
+	r.push_back(target.get());
+	return r;
+}
+
+std::string RefExprAST::printName() const { return mut ? "Ref (mut)" : "Ref"; }
+
+AST *RefExprAST::borrowed(ExprAST &expr) {
+	// a reference taken right here points into the place it was taken of
+	if (auto ref = dynamic_cast<RefExprAST *>(&expr)) {
+		ExprAST *place = IndexExprAST::base(*ref->target);
+		if (auto deref = dynamic_cast<DerefExprAST *>(place))
+			return borrowed(*deref->pointer);
+		auto variable = dynamic_cast<VariableExprAST *>(place);
+		return variable ? variable->resolved_name : nullptr;
+	}
+
+	// otherwise only a reference held in a variable can be followed, one
+	// loaded out of an array or returned by a call could point anywhere
+	auto variable = dynamic_cast<VariableExprAST *>(&expr);
+	if (variable == nullptr) return nullptr;
+	if (auto decl = dynamic_cast<VarDecl *>(variable->resolved_name))
+		return decl->value ? borrowed(*decl->value.value()) : nullptr;
+	return variable->resolved_name;
+}
+
+std::vector<AST *> DerefExprAST::getChildren() const {
+	std::vector<AST *> r;
+	r.push_back(pointer.get());
+	return r;
+}
+
+std::string DerefExprAST::printName() const { return "Deref"; }
+
 std::string VariableExprAST::printName() const {
 	return fmt::format("VariableExprAST ({})", name);
 }
@@ -62,6 +125,28 @@ std::vector<AST *> CallExprAST::getChildren() const {
 	return rets;
 }
 
+CallExprAST::Builtin CallExprAST::builtinNamed(std::string_view name) {
+	static const std::map<std::string_view, Builtin> builtins = {
+		{"likely", Builtin::Likely},
+		{"unlikely", Builtin::Unlikely},
+		{"splat", Builtin::Splat},
+		{"shuffle", Builtin::Shuffle},
+		{"reduce_add", Builtin::ReduceAdd},
+		{"reduce_mul", Builtin::ReduceMul},
+		{"reduce_min", Builtin::ReduceMin},
+		{"reduce_max", Builtin::ReduceMax},
+		{"reduce_and", Builtin::ReduceAnd},
+		{"reduce_or", Builtin::ReduceOr},
+		{"load", Builtin::Load},
+		{"store", Builtin::Store},
+		{"masked_load", Builtin::MaskedLoad},
+		{"masked_store", Builtin::MaskedStore},
+	};
+
+	auto found = builtins.find(name);
+	return found == builtins.end() ? Builtin::None : found->second;
+}
+
 std::string CallExprAST::printName() const {
 	return fmt::format("CallExpr ({})", Callee);
 }
@@ -93,6 +178,38 @@ std::vector<AST *> ExprStmt::getChildren() const {
 
 std::string ExprStmt::printName() const { return fmt::format("ExprStmt"); }
 
+std::vector<AST *> AssignStmt::getChildren() const {
+	std::vector<AST *> r;
+	r.push_back(target.get());
+	r.push_back(value.get());
+	return r;
+}
+
+ExprAST *IndexExprAST::base(ExprAST &place) {
+	ExprAST *node = &place;
+	while (true) {
+		if (auto index = dynamic_cast<IndexExprAST *>(node))
+			node = index->array.get();
+		else if (auto member = dynamic_cast<StructMemberAccessAST *>(node))
+			node = member->parent.get();
+		else
+			return node;
+	}
+}
+
+VariableExprAST *IndexExprAST::root(ExprAST &expr) {
+	return dynamic_cast<VariableExprAST *>(base(expr));
+}
+
+VariableExprAST *AssignStmt::variable() const {
+	return IndexExprAST::root(*target);
+}
+
+std::string AssignStmt::printName() const {
+	auto v = variable();
+	return fmt::format("Assign ({})", v ? v->name : "?");
+}
+
 std::string TypeAST::printName() const { return fmt::format("TypeAST ()"); }
 const TypeAST::ctype TypeAST::conversion[] = {
 	{.name = "i128", .value = Type::i128},
@@ -111,8 +228,50 @@ const TypeAST::ctype TypeAST::conversion[] = {
 	{.name = "f16", .value = Type::f16},
 	// {.name = "string", .value = Type::string},
 	{.name = "bool", .value = Type::_bool},
+	// followed by the lanes and their type, like `vec[4]f32`
+	{.name = "vec", .value = Type::vector},
 };
 
+std::string TypeAST::spelling() const {
+	switch (type) {
+	case Type::_struct:
+		return data;
+	case Type::pointer:
+		return (mut ? "&mut " : "&") + child.value()->spelling();
+	case Type::array:
+		return fmt::format("[{}]{}", length, child.value()->spelling());
+	case Type::vector:
+		return fmt::format("vec[{}]{}", length, child.value()->spelling());
+	case Type::__int:
+	case Type::__uint:
+		return "{integer}";
+	case Type::__float:
+		return "{float}";
+	default:
+		break;
+	}
+
+	for (auto &c : conversion)
+		if (c.value == type && !c.name.empty()) return c.name;
+	return "?";
+}
+
+TypeAST *TypeAST::builtin(Type type) {
+	// built once up front so handing them out from several threads is safe
+	static const auto types = [] {
+		std::map<Type, std::unique_ptr<TypeAST>> t;
+		// a vector is nothing without its lanes
+		for (auto &c : conversion)
+			if (!c.name.empty() && c.value != Type::vector)
+				t[c.value] =
+					std::make_unique<TypeAST>(c.value, std::nullopt, "");
+		return t;
+	}();
+
+	auto it = types.find(type);
+	return it == types.end() ? nullptr : it->second.get();
+}
+
 std::vector<AST *> StructMemberAST::getChildren() const {
 	std::vector<AST *> r;
 	r.push_back(value.get());
@@ -142,6 +301,18 @@ std::string StructMemberAccessAST::printName() const {
 	return fmt::format("StructMemberAccessAST ({})", name);
 }
 
+std::string LayoutExprAST::printName() const {
+	switch (query) {
+	case Query::Size:
+		return fmt::format("LayoutExprAST (sizeof {})", type->spelling());
+	case Query::Align:
+		return fmt::format("LayoutExprAST (alignof {})", type->spelling());
+	default:
+		return fmt::format("LayoutExprAST (offsetof {}.{})", type->spelling(),
+						   member);
+	}
+}
+
 std::string BlockAST::printName() const { return "BlockAST"; }
 
 std::vector<AST *> ParameterAST::getChildren() const {
@@ -217,6 +388,20 @@ std::vector<AST *> WhileStmt::getChildren() const {
 	return vec;
 }
 
+std::string ForStmt::printName() const {
+	return fmt::format("ForStmt ({})", variable->name);
+}
+
+std::vector<AST *> ForStmt::getChildren() const {
+	std::vector<AST *> vec;
+	if (array) vec.push_back(array.get());
+	if (start) vec.push_back(start.get());
+	if (end) vec.push_back(end.get());
+	if (step) vec.push_back(step.value().get());
+	vec.push_back(block.get());
+	return vec;
+}
+
 void BlockAST::accept(ASTVisitor &v) { v.visit(*this); }
 void BinaryExprAST::accept(ASTVisitor &v) { v.visit(*this); }
 void CallExprAST::accept(ASTVisitor &v) { v.visit(*this); }
@@ -224,18 +409,25 @@ void NumberExprAST::accept(ASTVisitor &v) { v.visit(*this); }
 void StringLiteralAST::accept(ASTVisitor &v) { v.visit(*this); }
 void BoolLiteralAST::accept(ASTVisitor &v) { v.visit(*this); }
 void StructLiteralAST::accept(ASTVisitor &v) { v.visit(*this); }
+void ArrayLiteralAST::accept(ASTVisitor &v) { v.visit(*this); }
+void IndexExprAST::accept(ASTVisitor &v) { v.visit(*this); }
+void RefExprAST::accept(ASTVisitor &v) { v.visit(*this); }
+void DerefExprAST::accept(ASTVisitor &v) { v.visit(*this); }
 void VariableExprAST::accept(ASTVisitor &v) { v.visit(*this); }
 void FileAST::accept(ASTVisitor &v) { v.visit(*this); }
 void FunctionAST::accept(ASTVisitor &v) { v.visit(*this); }
 void PrototypeAST::accept(ASTVisitor &v) { v.visit(*this); }
 void ParameterAST::accept(ASTVisitor &v) { v.visit(*this); }
 void ExprStmt::accept(ASTVisitor &v) { v.visit(*this); }
+void AssignStmt::accept(ASTVisitor &v) { v.visit(*this); }
 void ReturnStmt::accept(ASTVisitor &v) { v.visit(*this); }
 void VarDecl::accept(ASTVisitor &v) { v.visit(*this); }
 void TypeAST::accept(ASTVisitor &v) { v.visit(*this); }
 void StructAST::accept(ASTVisitor &v) { v.visit(*this); }
-void StructMemberAccessAST::accept(ASTVisitor &v) {} // v.visit(*this); }
+void StructMemberAccessAST::accept(ASTVisitor &v) { v.visit(*this); }
+void LayoutExprAST::accept(ASTVisitor &v) { v.visit(*this); }
 void StructMemberAST::accept(ASTVisitor &v) { v.visit(*this); }
 void IfStmt::accept(ASTVisitor &v) { v.visit(*this); }
 void WhileStmt::accept(ASTVisitor &v) { v.visit(*this); }
+void ForStmt::accept(ASTVisitor &v) { v.visit(*this); }
 } // namespace FoxLang
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "const_value.hpp"
 #include "tokens.hpp"
 
 #include <cstdlib>
@@ -19,29 +20,57 @@
 #include <map>
 #include <memory>
 #include <string>
+#include <string_view>
 #include <variant>
 #include <vector>
 
 namespace FoxLang {
 class ASTVisitor;
 
+/// Attribute - An annotation like `#[cold]` or `#[unroll(4)]` written in
+/// front of the item or statement it applies to. Arguments are kept as
+/// written, with the quotes taken off strings; `width=8` has a key, a bare
+/// argument does not. What an attribute means is up to the pass reading it.
+struct Attribute {
+	struct Arg {
+		std::string key;
+		std::string value;
+	};
+
+	std::string name;
+	std::vector<Arg> args;
+	SourceLoc loc;
+};
+
 class AST {
 public:
-	typedef std::variant<std::monostate, int, float, std::string, bool> Exec;
 	virtual ~AST() = default;
 
-	llvm::Value *llvm_value;
+	// Where the node starts in the source, expanded by the SourceManager only
+	// when something needs to be reported about it
+	SourceLoc loc;
+	std::vector<Attribute> attributes;
+
+	/// The first attribute called `name`, nullptr when there is none
+	const Attribute *attribute(std::string_view name) const;
 
 	virtual std::vector<AST *> getChildren() const;
 
 	virtual std::string printName() const;
 
-	virtual Exec exec();
-
 	virtual void accept(ASTVisitor &ir) = 0;
 };
 
-class ExprAST : public AST {};
+class TypeAST;
+class ExprAST : public AST {
+public:
+	// filled in by TypeCheck, nullptr when the expression has no type the
+	// checker understands
+	TypeAST *checked_type = nullptr;
+	// made by TypeCheck when no node in the tree spells out the type of the
+	// expression, checked_type points here then
+	std::shared_ptr<TypeAST> inferred;
+};
 
 class StmtAST : public AST {};
 
@@ -84,13 +113,15 @@ public:
 	void accept(ASTVisitor &ir) override;
 };
 
-class TypeAST;
 // Struct Instantiation
 class StructLiteralAST : public Literal {
 public:
 	std::vector<std::string> names;
 	std::vector<std::shared_ptr<ExprAST>> values;
 	TypeAST *type;
+	// position in StructAST::members of the member each value is for, set
+	// by TypeCheck
+	std::vector<size_t> fields;
 
 public:
 	StructLiteralAST(std::vector<std::string> names,
@@ -103,11 +134,27 @@ public:
 	void accept(ASTVisitor &ir) override;
 };
 
+/// ArrayLiteralAST - An array written out element by element, like
+/// `[1, 2, 3]`. Also makes a vector when one is expected.
+class ArrayLiteralAST : public Literal {
+public:
+	std::vector<std::shared_ptr<ExprAST>> elements;
+
+public:
+	ArrayLiteralAST(std::vector<std::shared_ptr<ExprAST>> elements)
+		: elements(std::move(elements)) {}
+
+	std::string printName() const override;
+	std::vector<AST *> getChildren() const override;
+
+	void accept(ASTVisitor &ir) override;
+};
+
 /// VariableExprAST - Expression class for referencing a variable, like "a".
 class VariableExprAST : public ExprAST {
 public:
 	std::string name;
-	AST *resolved_name;
+	AST *resolved_name = nullptr;
 
 public:
 	explicit VariableExprAST(const std::string &name) : name(name) {}
@@ -134,12 +181,110 @@ public:
 	void accept(ASTVisitor &ir) override;
 };
 
+/// IndexExprAST - An element of an array or a lane of a vector, like `a[i]`.
+class IndexExprAST : public ExprAST {
+public:
+	std::shared_ptr<ExprAST> array, index;
+	// cleared by BoundsCheck when the index is known to be in bounds, so no
+	// check is generated for it
+	bool checked = true;
+
+public:
+	IndexExprAST(std::shared_ptr<ExprAST> array, std::shared_ptr<ExprAST> index)
+		: array(std::move(array)), index(std::move(index)) {}
+
+	/// What `place` picks an element or member out of, through any number
+	/// of indexing and member access, `place` itself when it is neither
+	static ExprAST *base(ExprAST &place);
+
+	/// The variable `expr` indexes into, through any number of indexing or
+	/// member access, nullptr when it is not a variable
+	static VariableExprAST *root(ExprAST &expr);
+
+	std::vector<AST *> getChildren() const override;
+
+	std::string printName() const override;
+	void accept(ASTVisitor &ir) override;
+};
+
+/// RefExprAST - A reference to a variable or an element of one, like `&x`
+/// or `&mut a[i]`. A call never gets a `&mut` together with any other
+/// reference to the same variable, so nothing else a function can reach
+/// overlaps one of its `&mut` parameters.
+class RefExprAST : public ExprAST {
+public:
+	std::shared_ptr<ExprAST> target;
+	bool mut;
+
+public:
+	RefExprAST(std::shared_ptr<ExprAST> target, bool mut)
+		: target(std::move(target)), mut(mut) {}
+
+	/// The variable or reference parameter the reference `expr` points
+	/// into, following references held in a `let` back to where they were
+	/// taken, nullptr when that cannot be told
+	static AST *borrowed(ExprAST &expr);
+
+	std::vector<AST *> getChildren() const override;
+
+	std::string printName() const override;
+	void accept(ASTVisitor &ir) override;
+};
+
+/// DerefExprAST - What a reference points to, like `*p`. TypeCheck also puts
+/// one in front of a reference that is indexed or iterated over.
+class DerefExprAST : public ExprAST {
+public:
+	std::shared_ptr<ExprAST> pointer;
+
+public:
+	DerefExprAST(std::shared_ptr<ExprAST> pointer)
+		: pointer(std::move(pointer)) {}
+
+	std::vector<AST *> getChildren() const override;
+
+	std::string printName() const override;
+	void accept(ASTVisitor &ir) override;
+};
+
 /// CallExprAST - Expression class for function calls.
 class CallExprAST : public ExprAST {
 public:
+	/// Operations that are called like functions but have no definition,
+	/// the generator lowers them to instructions directly
+	enum class Builtin {
+		None,
+		// likely(c) and unlikely(c), just c, but a branch on it is laid out
+		// for the outcome named
+		Likely,
+		Unlikely,
+		// splat(x), every lane set to x
+		Splat,
+		// shuffle(a, b, 0, 4, 1, 5), lanes picked by constant index from a
+		// followed by b
+		Shuffle,
+		// reduce_add(v) and friends, all lanes combined into one value
+		ReduceAdd,
+		ReduceMul,
+		ReduceMin,
+		ReduceMax,
+		ReduceAnd,
+		ReduceOr,
+		// load(a, i) and store(a, i, v), as many elements of an array as
+		// the vector has lanes, starting at i
+		Load,
+		Store,
+		// masked_load(a, i, mask, passthru) and masked_store(a, i, v, mask),
+		// the same but only for the lanes set in mask
+		MaskedLoad,
+		MaskedStore,
+	};
+
 	std::string Callee;
 	std::vector<std::shared_ptr<ExprAST>> Args;
-	AST *resolved_name;
+	AST *resolved_name = nullptr;
+	// set by NameResolution when Callee names a builtin and no function
+	Builtin builtin = Builtin::None;
 
 public:
 	CallExprAST(const std::string &Callee,
@@ -148,6 +293,9 @@ public:
 	CallExprAST(AST *resolved_name, std::vector<std::shared_ptr<ExprAST>> Args)
 		: resolved_name(resolved_name), Args(std::move(Args)) {}
 
+	/// The builtin called `name`, Builtin::None when there is none
+	static Builtin builtinNamed(std::string_view name);
+
 	std::vector<AST *> getChildren() const override;
 
 	std::string printName() const override;
@@ -178,6 +326,7 @@ public:
 		_bool,
 		_struct,
 		array,
+		vector,
 		pointer,
 		__int,	// __: for internal use only, for unsized literals
 		__uint, // can implicitly cast to __int
@@ -187,6 +336,10 @@ public:
 	std::optional<std::shared_ptr<TypeAST>> child;
 	std::string data;
 	StructAST *resolved_name;
+	// number of elements of an array, or lanes of a vector
+	uint64_t length = 0;
+	// a `&mut` pointer, which may be written through
+	bool mut = false;
 
 	typedef struct {
 		std::string name;
@@ -202,22 +355,73 @@ public:
 
 	std::string printName() const override;
 
+	/// The type as it is written in source, for messages
+	std::string spelling() const;
+
+	/// A shared node for a type without children, for expressions whose type
+	/// is not written anywhere
+	static TypeAST *builtin(Type type);
+
 	void accept(ASTVisitor &ir) override;
 
 	inline bool operator==(const TypeAST &rhs) const {
 		if (type != rhs.type) return false;
 
 		if (type != Type::pointer && type != Type::array &&
-			type != Type::_struct)
+			type != Type::vector && type != Type::_struct)
 			return true;
 
 		if (type == Type::_struct) return resolved_name == rhs.resolved_name;
+		if (length != rhs.length || mut != rhs.mut) return false;
 
-		// both ptr and arr only have a child (no arr len rn)
-		// so simple child comparison
 		return *child.value().get() == *rhs.child.value().get();
 	}
 	inline bool operator!=(const TypeAST &rhs) const { return !(*this == rhs); }
+
+	inline bool isInteger() const {
+		return type >= Type::i128 && type <= Type::u8;
+	}
+	inline bool isSigned() const {
+		return type >= Type::i128 && type <= Type::i8;
+	}
+	inline bool isFloat() const {
+		return type >= Type::f128 && type <= Type::f16;
+	}
+	inline bool isVector() const { return type == Type::vector; }
+
+	/// The type of one lane for vectors, the type itself otherwise
+	inline const TypeAST &scalar() const {
+		return isVector() ? *child.value() : *this;
+	}
+
+	/// Width in bits of integer and float types, 0 for everything else
+	inline unsigned bits() const {
+		switch (type) {
+		case Type::i128:
+		case Type::u128:
+		case Type::f128:
+			return 128;
+		case Type::i64:
+		case Type::u64:
+		case Type::f64:
+			return 64;
+		case Type::i32:
+		case Type::u32:
+		case Type::f32:
+			return 32;
+		case Type::i16:
+		case Type::u16:
+		case Type::f16:
+			return 16;
+		case Type::i8:
+		case Type::u8:
+			return 8;
+		case Type::_bool:
+			return 1;
+		default:
+			return 0;
+		}
+	}
 };
 
 class VarDecl : public StmtAST {
@@ -226,6 +430,10 @@ public:
 	std::shared_ptr<TypeAST> type;
 	std::optional<std::shared_ptr<ExprAST>> value;
 	bool mut;
+	// `const` declarations, their value is computed by ConstEval and stored
+	// in folded before any code is generated
+	bool constant = false;
+	std::optional<ConstValue> folded;
 
 public:
 	VarDecl(const std::string &name, std::shared_ptr<TypeAST> type,
@@ -269,13 +477,34 @@ public:
 	void accept(ASTVisitor &ir) override;
 };
 
+/// AssignStmt - Stores a new value into a `let mut` variable, like "a = 1;".
+class AssignStmt : public StmtAST {
+public:
+	// a variable, or an element of one like `a[i]`
+	std::shared_ptr<ExprAST> target;
+	std::shared_ptr<ExprAST> value;
+
+public:
+	AssignStmt(std::shared_ptr<ExprAST> target, std::shared_ptr<ExprAST> value)
+		: target(std::move(target)), value(std::move(value)) {}
+
+	/// The variable the assignment writes into, nullptr when the target is
+	/// not something that can be assigned to
+	VariableExprAST *variable() const;
+
+	std::vector<AST *> getChildren() const override;
+
+	std::string printName() const override;
+
+	void accept(ASTVisitor &ir) override;
+};
+
 // i think that its better to not have this as a seperate class and have the
 // struct manage it, but this makes things like name res easier
 class StructMemberAST : public AST {
 public:
 	std::string name;
 	std::shared_ptr<TypeAST> value;
-	llvm::Value *llvm_value;
 
 public:
 	StructMemberAST(std::string name, std::shared_ptr<TypeAST> value)
@@ -290,7 +519,8 @@ class StructAST : public AST {
 public:
 	std::string name;
 	std::vector<std::shared_ptr<StructMemberAST>> members;
-	llvm::StructType *llvm_value;
+	// cleared by the TreeShaker when nothing reachable uses the struct
+	bool used = true;
 
 public:
 	StructAST(std::string name,
@@ -305,18 +535,42 @@ public:
 class StructMemberAccessAST : public ExprAST {
 public:
 	std::string name;
-	std::shared_ptr<TypeAST> member_type;
-	std::shared_ptr<AST> parent;
+	std::shared_ptr<ExprAST> parent;
+	// position of the member in StructAST::members, set by TypeCheck
+	size_t index = 0;
 
 public:
-	StructMemberAccessAST(std::string name, std::shared_ptr<AST> parent)
-		: name(name), parent(parent) {}
+	StructMemberAccessAST(std::string name, std::shared_ptr<ExprAST> parent)
+		: name(name), parent(std::move(parent)) {}
 
 	std::vector<AST *> getChildren() const override;
 	std::string printName() const override;
 	void accept(ASTVisitor &ir) override;
 };
 
+/// LayoutExprAST - `sizeof(T)`, `alignof(T)` or `offsetof(T, member)`, an
+/// integer constant only the generator knows, from the data layout of the
+/// target and the layout attributes of structs.
+class LayoutExprAST : public ExprAST {
+public:
+	enum class Query { Size, Align, Offset };
+
+	Query query;
+	std::shared_ptr<TypeAST> type;
+	// the member asked for by offsetof
+	std::string member;
+	// position of the member in StructAST::members, set by TypeCheck
+	size_t index = 0;
+
+public:
+	LayoutExprAST(Query query, std::shared_ptr<TypeAST> type,
+				  std::string member)
+		: query(query), type(std::move(type)), member(std::move(member)) {}
+
+	std::string printName() const override;
+	void accept(ASTVisitor &ir) override;
+};
+
 class BlockAST : public AST {
 public:
 	std::vector<std::shared_ptr<StmtAST>> content;
@@ -366,6 +620,33 @@ public:
 	void accept(ASTVisitor &ir) override;
 };
 
+/// ForStmt - A counted loop, either over a range of integers like
+/// `for i in 0..n step 2` or over the elements of an array like
+/// `for x in a`. The bounds and the array are evaluated once, before the
+/// first iteration.
+class ForStmt : public StmtAST {
+public:
+	// declared by the loop itself and never mutable, the type is filled in
+	// by TypeCheck when the source does not give one
+	std::shared_ptr<VarDecl> variable;
+	// the range, end is exclusive and step defaults to 1
+	std::shared_ptr<ExprAST> start, end;
+	std::optional<std::shared_ptr<ExprAST>> step;
+	// the array iterated over instead of a range
+	std::shared_ptr<ExprAST> array;
+	std::shared_ptr<BlockAST> block;
+
+public:
+	ForStmt(std::shared_ptr<VarDecl> variable, std::shared_ptr<BlockAST> block)
+		: variable(std::move(variable)), block(std::move(block)) {}
+
+	std::vector<AST *> getChildren() const override;
+
+	std::string printName() const override;
+
+	void accept(ASTVisitor &ir) override;
+};
+
 /// ParameteAST - Represents the paramteres for a function to ease the process
 /// of name resolution and ir generation
 class ParameterAST : public AST {
@@ -373,6 +654,12 @@ public:
 	std::string name;
 	std::shared_ptr<TypeAST> type;
 
+public:
+	// cleared by Effects when the function never writes through the
+	// parameter, or keeps no copy of it once it returns
+	bool written = true;
+	bool captured = true;
+
 public:
 	ParameterAST(std::string name, std::shared_ptr<TypeAST> type)
 		: name(name), type(type) {}
@@ -390,6 +677,15 @@ public:
 	std::string name;
 	std::vector<std::shared_ptr<ParameterAST>> parameters;
 	std::shared_ptr<TypeAST> retType;
+	// what a call can do besides computing its result, narrowed by Effects.
+	// The only memory a call can reach is what reference parameters point
+	// to, nothing else outlives it
+	bool reads = true;
+	bool writes = true;
+	// may stop the program when a check fails
+	bool traps = true;
+	// may never come back, through a `while` or recursion
+	bool diverges = true;
 
 public:
 	PrototypeAST(const std::string &name,
@@ -411,6 +707,9 @@ class FunctionAST : public AST {
 public:
 	std::shared_ptr<PrototypeAST> proto;
 	std::shared_ptr<BlockAST> body;
+	// cleared by the TreeShaker when it cannot be reached from main or an
+	// exported symbol
+	bool used = true;
 
 public:
 	FunctionAST(std::shared_ptr<PrototypeAST> proto,
@@ -438,17 +737,6 @@ public:
 
 	std::string printName() const override;
 
-	Exec exec() override {
-		for (auto i : expressions) {
-			if (dynamic_cast<FunctionAST *>(i.get()) &&
-				((FunctionAST *)i.get())->proto->name == "main") {
-				i->exec();
-				return std::monostate{};
-			}
-		}
-		return std::monostate{};
-	}
-
 	void accept(ASTVisitor &ir) override;
 };
 
@@ -460,16 +748,23 @@ inline int getPrecedence(TokenType token) {
 		return 20;
 	case TokenType::OR:
 		return 30;
+	case TokenType::EQUAL_EQUAL:
+	case TokenType::BANG_EQUAL:
+		return 35;
 	case TokenType::LESS:
 	case TokenType::LESS_EQUAL:
 	case TokenType::GREATER:
 	case TokenType::GREATER_EQUAL:
 		return 40;
+	case TokenType::LEFT_SHIFT:
+	case TokenType::RIGHT_SHIFT:
+		return 45;
 	case TokenType::MINUS:
 	case TokenType::PLUS:
 		return 50;
 	case TokenType::STAR:
 	case TokenType::SLASH:
+	case TokenType::PERCENT:
 		return 60;
 	default:
 		return -1;
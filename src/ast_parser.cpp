@@ -2,10 +2,11 @@
 #include "ast_nodes.hpp"
 #include <fmt/format.h>
 #include <iostream>
+#include <llvm/ADT/StringRef.h>
 
 namespace FoxLang {
 std::optional<std::shared_ptr<ExprAST>> Parser::parseNumberExpr() {
-	auto ret = std::make_shared<NumberExprAST>(current->lexeme);
+	auto ret = make<NumberExprAST>(current->loc, current->lexeme);
 	current++;
 	return ret;
 }
@@ -27,11 +28,17 @@ std::optional<std::shared_ptr<ExprAST>> Parser::parseParenExpr() {
 
 std::optional<std::shared_ptr<ExprAST>> Parser::parseIdentifierExpr() {
 	std::string identifierString = current->lexeme;
+	SourceLoc loc = current->loc;
 	current++;
 
-	if (!(current->type == TokenType::LEFT_PAREN ||
-		  current->type == TokenType::DOT)) // Simple variable ref.
-		return std::make_shared<VariableExprAST>(identifierString);
+	if (current->type != TokenType::LEFT_PAREN) // Simple variable ref.
+		return make<VariableExprAST>(loc, identifierString);
+
+	// these take a type rather than values
+	using Q = LayoutExprAST::Query;
+	if (identifierString == "sizeof") return parseLayoutExpr(Q::Size, loc);
+	if (identifierString == "alignof") return parseLayoutExpr(Q::Align, loc);
+	if (identifierString == "offsetof") return parseLayoutExpr(Q::Offset, loc);
 
 	bool call = false;
 	std::shared_ptr<CallExprAST> ast_call;
@@ -58,29 +65,103 @@ std::optional<std::shared_ptr<ExprAST>> Parser::parseIdentifierExpr() {
 
 		if (call)
 			ast_call =
-				std::make_shared<CallExprAST>(ast_call.get(), std::move(Args));
+				make<CallExprAST>(loc, ast_call.get(), std::move(Args));
 		else
-			ast_call = std::make_shared<CallExprAST>(identifierString,
-													 std::move(Args));
+			ast_call =
+				make<CallExprAST>(loc, identifierString, std::move(Args));
 		call = true;
 	}
 
-	if (current->type != TokenType::DOT) return ast_call;
+	return ast_call;
+}
 
-	std::shared_ptr<ExprAST> access = ast_call;
-	while (current->type == TokenType::DOT) {
+std::optional<std::shared_ptr<ExprAST>>
+Parser::parseLayoutExpr(LayoutExprAST::Query query, SourceLoc loc) {
+	// Eat the '('.
+	current++;
+	auto type = parseType();
+	if (!type) return std::nullopt;
+
+	std::string member;
+	if (query == LayoutExprAST::Query::Offset) {
+		if (current->type != TokenType::COMMA) {
+			LogError("Expected a member name after the type", "E0134");
+			return std::nullopt;
+		}
 		current++;
 		if (current->type != TokenType::IDENTIFIER) {
-			LogError("expected identifier after member access .", "bing bong");
+			LogError("Expected a member name after the type", "E0134");
 			return std::nullopt;
 		}
+		member = current->lexeme;
+		current++;
+	}
+
+	if (current->type != TokenType::RIGHT_PAREN) {
+		LogError("Expected closing parenthesis", "E0003");
+		return std::nullopt;
+	}
+	current++;
+	return make<LayoutExprAST>(loc, query, type.value(), member);
+}
+
+std::optional<std::shared_ptr<ExprAST>> Parser::parseArrayLiteral() {
+	SourceLoc loc = current->loc;
+	current++; // the [
+
+	std::vector<std::shared_ptr<ExprAST>> elements;
+	while (current->type != TokenType::RIGHT_SQUARE_BRACKET) {
+		auto element = parseExpression();
+		if (!element) return std::nullopt;
+		elements.push_back(std::move(element.value()));
+
+		if (current->type != TokenType::COMMA) break;
+		current++;
+	}
+
+	if (current->type != TokenType::RIGHT_SQUARE_BRACKET) {
+		LogError("Expected ']' after the elements of the array", "E0126");
+		return std::nullopt;
+	}
+	current++;
+
+	return make<ArrayLiteralAST>(loc, std::move(elements));
+}
+
+std::optional<std::shared_ptr<ExprAST>>
+Parser::parseIndex(std::optional<std::shared_ptr<ExprAST>> array) {
+	while (array && (current->type == TokenType::LEFT_SQUARE_BRACKET ||
+					 current->type == TokenType::DOT)) {
+		// `a[i].x[j]`, members and elements in any order
+		if (current->type == TokenType::DOT) {
+			current++;
+			if (current->type != TokenType::IDENTIFIER) {
+				LogError("Expected a member name after '.'", "E0133");
+				return std::nullopt;
+			}
+			array = make<StructMemberAccessAST>(
+				current->loc, current->lexeme, std::move(array.value()));
+			current++;
+			continue;
+		}
+
+		SourceLoc loc = current->loc;
+		current++;
 
-		access =
-			std::make_shared<StructMemberAccessAST>(current->lexeme, access);
+		auto index = parseExpression();
+		if (!index) return std::nullopt;
+
+		if (current->type != TokenType::RIGHT_SQUARE_BRACKET) {
+			LogError("Expected ']' after the index", "E0127");
+			return std::nullopt;
+		}
 		current++;
+
+		array = make<IndexExprAST>(loc, std::move(array.value()),
+								   std::move(index.value()));
 	}
 
-	return access;
+	return array;
 }
 
 std::optional<std::shared_ptr<ExprAST>> Parser::parsePrimary() {
@@ -92,23 +173,35 @@ std::optional<std::shared_ptr<ExprAST>> Parser::parsePrimary() {
 			"E0102");
 		return std::nullopt;
 	case TokenType::IDENTIFIER:
-		return parseIdentifierExpr();
+		return parseIndex(parseIdentifierExpr());
 	case TokenType::NUMBER:
 		return parseNumberExpr();
 	case TokenType::LEFT_PAREN:
-		return parseParenExpr();
+		return parseIndex(parseParenExpr());
+	case TokenType::LEFT_SQUARE_BRACKET:
+		return parseIndex(parseArrayLiteral());
+	case TokenType::BITWISE_AND:
+		return parseRefExpr();
+	case TokenType::STAR: {
+		// `*p[i]` is `*(p[i])`, like taking a reference
+		SourceLoc loc = current->loc;
+		current++;
+		auto pointer = parsePrimary();
+		if (!pointer) return std::nullopt;
+		return make<DerefExprAST>(loc, std::move(pointer.value()));
+	}
 	case TokenType::STRING: {
 		auto c = current->lexeme;
 		current++;
-		return std::make_shared<StringLiteralAST>(c);
+		return make<StringLiteralAST>((current - 1)->loc, c);
 	}
 	case TokenType::TRUE: {
 		current++;
-		return std::make_shared<BoolLiteralAST>(true);
+		return make<BoolLiteralAST>((current - 1)->loc, true);
 	}
 	case TokenType::FALSE: {
 		current++;
-		return std::make_shared<BoolLiteralAST>(false);
+		return make<BoolLiteralAST>((current - 1)->loc, false);
 	}
 	case TokenType::DOT: {
 		if ((current + 1)->type == TokenType::LEFT_BRACKET) {
@@ -118,6 +211,18 @@ std::optional<std::shared_ptr<ExprAST>> Parser::parsePrimary() {
 	}
 }
 
+std::optional<std::shared_ptr<ExprAST>> Parser::parseRefExpr() {
+	SourceLoc loc = current->loc;
+	current++; // move past &
+
+	bool mut = current->type == TokenType::MUT;
+	if (mut) current++;
+
+	auto target = parsePrimary();
+	if (!target) return std::nullopt;
+	return make<RefExprAST>(loc, std::move(target.value()), mut);
+}
+
 std::optional<std::shared_ptr<StructLiteralAST>> Parser::parseStructInstance() {
 	if (current->type != TokenType::DOT ||
 		(current + 1)->type != TokenType::LEFT_BRACKET) {
@@ -126,6 +231,7 @@ std::optional<std::shared_ptr<StructLiteralAST>> Parser::parseStructInstance() {
 	}
 
 	// .{
+	SourceLoc loc = current->loc;
 	current += 2;
 
 	std::vector<std::string> names;
@@ -162,7 +268,7 @@ std::optional<std::shared_ptr<StructLiteralAST>> Parser::parseStructInstance() {
 
 	current++;
 
-	return std::make_shared<StructLiteralAST>(names, vals);
+	return make<StructLiteralAST>(loc, names, vals);
 }
 
 std::optional<std::shared_ptr<ExprAST>> Parser::parseExpression() {
@@ -174,33 +280,76 @@ std::optional<std::shared_ptr<ExprAST>> Parser::parseExpression() {
 
 std::optional<std::shared_ptr<StmtAST>> Parser::parseStatement() {
 	switch (current->type) {
+	case TokenType::HASH: {
+		auto attributes = parseAttributes();
+		auto stmt = parseStatement();
+		if (stmt) stmt.value()->attributes = std::move(attributes);
+		return stmt;
+	}
 	case TokenType::LET:
 		return parseLet();
+	case TokenType::CONST:
+		return parseConst();
 	case TokenType::RETURN:
 		return parseReturnStmt();
 	case TokenType::IF:
 		return parseIfStmt();
 	case TokenType::WHILE:
 		return parseWhileStmt();
+	case TokenType::FOR:
+		return parseForStmt();
 	default:
 		return parseExprStatement();
 	}
 }
 
-std::optional<std::shared_ptr<ExprStmt>> Parser::parseExprStatement() {
+std::optional<std::shared_ptr<StmtAST>>
+Parser::parseAssign(std::shared_ptr<ExprAST> target) {
+	if (!dynamic_cast<VariableExprAST *>(target.get()) &&
+		!dynamic_cast<IndexExprAST *>(target.get()) &&
+		!dynamic_cast<StructMemberAccessAST *>(target.get()) &&
+		!dynamic_cast<DerefExprAST *>(target.get())) {
+		LogError("Can only assign to a variable, an element of an array, a "
+				 "member of a struct or through a reference",
+				 "E0128");
+		return std::nullopt;
+	}
+	current++; // the =
+
+	auto value = parseExpression();
+	if (!value) {
+		LogError("Expected expression after '='", "E0118");
+		return std::nullopt;
+	}
+
+	if (current->type != TokenType::SEMICOLON) {
+		LogError("expected ; after assignment", "E0119");
+		return std::nullopt;
+	}
+	current++;
+
+	SourceLoc loc = target->loc;
+	return make<AssignStmt>(loc, std::move(target), std::move(value.value()));
+}
+
+std::optional<std::shared_ptr<StmtAST>> Parser::parseExprStatement() {
+	SourceLoc loc = current->loc;
 	auto expr = parseExpression();
 	if (!expr) {
 		LogError("Expected expression", "E0103");
 		return std::nullopt;
 	}
 
+	if (current->type == TokenType::EQUAL)
+		return parseAssign(std::move(expr.value()));
+
 	if (current->type != TokenType::SEMICOLON) {
 		LogError("expected ; after expression", "E0005");
 		return std::nullopt;
 	}
 	current++;
 
-	return std::make_shared<ExprStmt>(std::move(expr.value()));
+	return make<ExprStmt>(loc, std::move(expr.value()));
 }
 
 std::optional<std::shared_ptr<BlockAST>> Parser::parseBlock() {
@@ -208,22 +357,25 @@ std::optional<std::shared_ptr<BlockAST>> Parser::parseBlock() {
 		LogError("Expected '{' to start block", "E0006");
 		return std::nullopt;
 	}
+	SourceLoc loc = current->loc;
 	current++;
 
 	std::vector<std::shared_ptr<StmtAST>> content;
 
-	while (current->type != TokenType::RIGHT_BRACKET) {
+	while (current->type != TokenType::RIGHT_BRACKET &&
+		   !diagnostics.shouldAbort()) {
 		auto stmt = parseStatement();
 		if (stmt) content.push_back(std::move(stmt.value()));
 	}
 
 	current++;
-	return std::make_shared<BlockAST>(std::move(content), false);
+	return make<BlockAST>(loc, std::move(content), false);
 }
 
 std::optional<std::shared_ptr<BlockAST>> Parser::parseBklessBlock() {
 	if (current->type == TokenType::LEFT_BRACKET) return parseBlock();
 
+	SourceLoc loc = current->loc;
 	auto stmt = parseStatement();
 	if (!stmt) {
 		LogError("Unable to parse bracketless block, unable to parse statement",
@@ -231,8 +383,8 @@ std::optional<std::shared_ptr<BlockAST>> Parser::parseBklessBlock() {
 		return std::nullopt;
 	}
 
-	return std::make_shared<BlockAST>(
-		std::vector<std::shared_ptr<StmtAST>>{stmt.value()}, true);
+	return make<BlockAST>(
+		loc, std::vector<std::shared_ptr<StmtAST>>{stmt.value()}, true);
 }
 
 std::optional<std::shared_ptr<ExprAST>>
@@ -249,29 +401,83 @@ Parser::parseBinOpRHS(int precedence,
 		auto rhs = parsePrimary();
 		if (!rhs) return std::nullopt;
 
-		if (precedence < getPrecedence(current->type)) {
-			rhs = parseBinOpRHS(precedence + 1, std::move(rhs));
+		// only operators binding tighter than this one belong to its rhs,
+		// equal ones associate to the left
+		if (currentPrecedence < getPrecedence(current->type)) {
+			rhs = parseBinOpRHS(currentPrecedence + 1, std::move(rhs));
 			if (!rhs) return std::nullopt;
 		}
 
-		lhs = std::make_shared<BinaryExprAST>(
-			binaryOperator, std::move(lhs.value()), std::move(rhs.value()));
+		SourceLoc loc = lhs.value()->loc;
+		lhs = make<BinaryExprAST>(loc, binaryOperator, std::move(lhs.value()),
+								  std::move(rhs.value()));
 	}
 }
 
-std::optional<std::shared_ptr<TypeAST>> Parser::parseType() {
-	std::cout << "Type " << current->lexeme << std::endl;
-	if (current->type == TokenType::LEFT_SQUARE_BRACKET) {
-		auto count = parseNumberExpr();
-		current++;
-		auto child = parseType();
+std::optional<uint64_t> Parser::parseLength(std::string_view what) {
+	current++;
+
+	uint64_t length;
+	if (current->type != TokenType::NUMBER ||
+		llvm::StringRef(current->lexeme).getAsInteger(10, length)) {
+		LogError(fmt::format("Expected the length of the {}", what), "E0124");
 		return std::nullopt;
 	}
+	current++;
 
-	bool pointer = false;
+	if (current->type != TokenType::RIGHT_SQUARE_BRACKET) {
+		LogError(fmt::format("Expected ']' after the length of the {}", what),
+				 "E0125");
+		return std::nullopt;
+	}
+	current++;
+	return length;
+}
+
+// `v4f32` is short for `vec[4]f32`
+static bool vectorShorthand(llvm::StringRef name, uint64_t &lanes,
+							TypeAST::Type &element) {
+	if (!name.consume_front("v") || name.consumeInteger(10, lanes))
+		return false;
+
+	for (auto i : TypeAST::conversion) {
+		if (i.name == name && i.value != TypeAST::Type::vector) {
+			element = i.value;
+			return true;
+		}
+	}
+	return false;
+}
+
+std::optional<std::shared_ptr<TypeAST>> Parser::parseType() {
+	// `&T` or `&mut T`, a reference to any type including arrays
 	if (current->type == TokenType::BITWISE_AND) {
-		pointer = true;
+		SourceLoc loc = current->loc;
 		current++;
+		bool mut = current->type == TokenType::MUT;
+		if (mut) current++;
+
+		auto child = parseType();
+		if (!child) return std::nullopt;
+
+		auto pointer = make<TypeAST>(loc, TypeAST::Type::pointer,
+									 std::move(child.value()), "&");
+		pointer->mut = mut;
+		return pointer;
+	}
+
+	if (current->type == TokenType::LEFT_SQUARE_BRACKET) {
+		SourceLoc loc = current->loc;
+		auto length = parseLength("array");
+		if (!length) return std::nullopt;
+
+		auto child = parseType();
+		if (!child) return std::nullopt;
+
+		auto array = make<TypeAST>(loc, TypeAST::Type::array,
+								   std::move(child.value()), "");
+		array->length = *length;
+		return array;
 	}
 
 	if (current->type != TokenType::IDENTIFIER) {
@@ -279,6 +485,7 @@ std::optional<std::shared_ptr<TypeAST>> Parser::parseType() {
 		return std::nullopt;
 	}
 
+	SourceLoc name_loc = current->loc;
 	std::string type = current->lexeme;
 	TypeAST::Type t = TypeAST::Type::_struct;
 	current++;
@@ -290,15 +497,54 @@ std::optional<std::shared_ptr<TypeAST>> Parser::parseType() {
 		}
 	}
 
-	if (pointer)
-		return std::make_shared<TypeAST>(
-			TypeAST::Type::pointer,
-			std::make_shared<TypeAST>(t, std::nullopt, type), "&");
+	std::shared_ptr<TypeAST> base;
+	uint64_t lanes = 0;
+	TypeAST::Type element;
+	if (t == TypeAST::Type::vector) {
+		if (current->type != TokenType::LEFT_SQUARE_BRACKET) {
+			LogError("Expected '[' and the lanes of the vector", "E0124");
+			return std::nullopt;
+		}
+		auto length = parseLength("vector");
+		if (!length) return std::nullopt;
+
+		SourceLoc child_loc = current->loc;
+		auto child = parseType();
+		if (!child) return std::nullopt;
 
-	return std::make_shared<TypeAST>(t, std::nullopt, type);
+		auto c = child.value()->type;
+		if (c == TypeAST::Type::_struct || c == TypeAST::Type::array ||
+			c == TypeAST::Type::vector || c == TypeAST::Type::pointer) {
+			diagnostics.report(Message{
+				.message = "The lanes of a vector have to be numbers or bool",
+				.level = Severity::Error,
+				.code = "E0129",
+				.span = Location{.loc = child_loc, .length = 1}});
+			return std::nullopt;
+		}
+		lanes = *length;
+		base = make<TypeAST>(name_loc, t, std::move(child.value()), "");
+	} else if (t == TypeAST::Type::_struct &&
+			   vectorShorthand(type, lanes, element)) {
+		base = make<TypeAST>(name_loc, TypeAST::Type::vector,
+							 make<TypeAST>(name_loc, element, std::nullopt, ""),
+							 "");
+	} else {
+		base = make<TypeAST>(name_loc, t, std::nullopt, type);
+	}
+
+	if (base->isVector()) {
+		if (lanes == 0) {
+			LogError("A vector needs at least one lane", "E0129");
+			return std::nullopt;
+		}
+		base->length = lanes;
+	}
+	return base;
 }
 
 std::optional<std::shared_ptr<StructAST>> Parser::parseStruct() {
+	SourceLoc loc = current->loc;
 	current++;
 
 	std::string name = current->lexeme;
@@ -315,7 +561,9 @@ std::optional<std::shared_ptr<StructAST>> Parser::parseStruct() {
 	std::vector<std::shared_ptr<StructMemberAST>> members;
 
 	while (current->type != TokenType::RIGHT_BRACKET) {
+		auto attributes = parseAttributes();
 		auto name = current->lexeme;
+		SourceLoc member_loc = current->loc;
 		if (current->type != TokenType::IDENTIFIER)
 			LogError("Expected name for element in struct", "E0400");
 		current++;
@@ -332,16 +580,18 @@ std::optional<std::shared_ptr<StructAST>> Parser::parseStruct() {
 			current++;
 
 		members.push_back(
-			std::make_shared<StructMemberAST>(name, type.value()));
+			make<StructMemberAST>(member_loc, name, type.value()));
+		members.back()->attributes = std::move(attributes);
 	}
 
 	current++;
 
-	return std::make_shared<StructAST>(name, members);
+	return make<StructAST>(loc, name, members);
 }
 
 std::optional<std::shared_ptr<VarDecl>> Parser::parseLet() {
 	// Move past `let` token, onto either a `mut` token or the var name
+	SourceLoc loc = current->loc;
 	current++;
 
 	bool mut = false;
@@ -362,7 +612,8 @@ std::optional<std::shared_ptr<VarDecl>> Parser::parseLet() {
 	}
 
 	if (current->type == TokenType::SEMICOLON) {
-		return std::make_shared<VarDecl>(name, type.value(), std::nullopt, mut);
+		current++;
+		return make<VarDecl>(loc, name, type.value(), std::nullopt, mut);
 	}
 
 	if (current->type != TokenType::EQUAL) {
@@ -379,10 +630,53 @@ std::optional<std::shared_ptr<VarDecl>> Parser::parseLet() {
 	}
 	current++;
 
-	return std::make_shared<VarDecl>(name, type.value(), std::move(value), mut);
+	return make<VarDecl>(loc, name, type.value(), std::move(value), mut);
+}
+
+std::optional<std::shared_ptr<VarDecl>> Parser::parseConst() {
+	// Move past `const` onto the name, unlike let a const always has a value
+	SourceLoc loc = current->loc;
+	current++;
+
+	if (current->type != TokenType::IDENTIFIER) {
+		LogError("Expected a name for the const", "E0114");
+		return std::nullopt;
+	}
+
+	std::string name = current->lexeme;
+	current++;
+
+	auto type = parseType();
+	if (!type) {
+		LogError("A const needs a type", "E0115");
+		return std::nullopt;
+	}
+
+	if (current->type != TokenType::EQUAL) {
+		LogError("A const needs a value", "E0116");
+		return std::nullopt;
+	}
+	current++;
+
+	auto value = parseExpression();
+	if (!value) {
+		LogError("Expected an expression after the = of a const", "E0117");
+		return std::nullopt;
+	}
+
+	if (current->type != TokenType::SEMICOLON) {
+		LogError("expected ; after const", "E0005");
+		return std::nullopt;
+	}
+	current++;
+
+	auto decl = make<VarDecl>(loc, name, type.value(), std::move(value), false);
+	decl->constant = true;
+	return decl;
 }
 
 std::optional<std::shared_ptr<IfStmt>> Parser::parseIfStmt() {
+	SourceLoc loc = current->loc;
 	current++; // move past if statement
 
 	auto cond = parseExpression();
@@ -390,27 +684,35 @@ std::optional<std::shared_ptr<IfStmt>> Parser::parseIfStmt() {
 		LogError("Need a condition for an if statement", "E0106");
 	}
 
+	// `if c #[cold] { }`, attributes in front of an arm belong to its block
+	std::vector<Attribute> attributes;
+	if (current->type == TokenType::HASH) attributes = parseAttributes();
 	auto block = parseBklessBlock();
 	if (!block) {
 		LogError("Need a block for an if statement", "E0107");
-	}
+	} else
+		block.value()->attributes = std::move(attributes);
 
 	std::optional<std::shared_ptr<BlockAST>> else_ = std::nullopt;
 	if (current->type == TokenType::ELSE) {
-		current++;					// Move past else
+		current++; // Move past else
+		attributes.clear();
+		if (current->type == TokenType::HASH) attributes = parseAttributes();
 		else_ = parseBklessBlock(); // If else chains will have the if stored
 									// inside the else of the previous if
 		if (!else_) {
 			LogError("Unable to parse block inside else", "E0108");
-		}
+		} else
+			else_.value()->attributes = std::move(attributes);
 	}
 
 	if (!cond || !block) return std::nullopt;
-	return std::make_shared<IfStmt>(std::move(cond.value()),
-									std::move(block.value()), std::move(else_));
+	return make<IfStmt>(loc, std::move(cond.value()), std::move(block.value()),
+						std::move(else_));
 }
 
 std::optional<std::shared_ptr<WhileStmt>> Parser::parseWhileStmt() {
+	SourceLoc loc = current->loc;
 	current++; // move past while statement
 
 	auto cond = parseExpression();
@@ -424,8 +726,80 @@ std::optional<std::shared_ptr<WhileStmt>> Parser::parseWhileStmt() {
 	}
 
 	if (!cond || !block) return std::nullopt;
-	return std::make_shared<WhileStmt>(std::move(cond.value()),
-									   std::move(block.value()));
+	return make<WhileStmt>(loc, std::move(cond.value()),
+						   std::move(block.value()));
+}
+
+std::optional<std::shared_ptr<ForStmt>> Parser::parseForStmt() {
+	SourceLoc loc = current->loc;
+	current++; // move past for
+
+	if (current->type != TokenType::IDENTIFIER) {
+		LogError("Expected the name of the loop variable", "E0130");
+		return std::nullopt;
+	}
+	SourceLoc name_loc = current->loc;
+	std::string name = current->lexeme;
+	current++;
+
+	// the type may be left out, it is worked out from the range then
+	std::shared_ptr<TypeAST> type;
+	if (current->type != TokenType::IN) {
+		auto t = parseType();
+		if (!t) return std::nullopt;
+		type = std::move(t.value());
+	}
+
+	if (current->type != TokenType::IN) {
+		LogError("Expected 'in' after the loop variable", "E0131");
+		return std::nullopt;
+	}
+	current++;
+
+	auto first = parseExpression();
+	if (!first) return std::nullopt;
+
+	std::shared_ptr<ExprAST> start, end, array;
+	std::optional<std::shared_ptr<ExprAST>> step;
+	if (current->type == TokenType::DOT_DOT) {
+		current++;
+		auto last = parseExpression();
+		if (!last) {
+			LogError("Expected the end of the range", "E0132");
+			return std::nullopt;
+		}
+		start = std::move(first.value());
+		end = std::move(last.value());
+
+		// `step` is only a keyword right after a range
+		if (current->type == TokenType::IDENTIFIER &&
+			current->lexeme == "step") {
+			current++;
+			step = parseExpression();
+			if (!step) {
+				LogError("Expected the step of the range", "E0132");
+				return std::nullopt;
+			}
+		}
+	} else {
+		array = std::move(first.value());
+	}
+
+	auto block = parseBklessBlock();
+	if (!block) {
+		LogError("Need a block for a for statement", "E0113");
+		return std::nullopt;
+	}
+
+	auto variable =
+		make<VarDecl>(name_loc, name, std::move(type), std::nullopt, false);
+	auto loop =
+		make<ForStmt>(loc, std::move(variable), std::move(block.value()));
+	loop->start = std::move(start);
+	loop->end = std::move(end);
+	loop->step = std::move(step);
+	loop->array = std::move(array);
+	return loop;
 }
 
 std::optional<std::shared_ptr<PrototypeAST>> Parser::parsePrototype() {
@@ -435,6 +809,7 @@ std::optional<std::shared_ptr<PrototypeAST>> Parser::parsePrototype() {
 	}
 
 	std::string name = current->lexeme;
+	SourceLoc loc = current->loc;
 	current++;
 
 	if (current->type != TokenType::LEFT_PAREN) {
@@ -443,11 +818,13 @@ std::optional<std::shared_ptr<PrototypeAST>> Parser::parsePrototype() {
 	}
 
 	std::vector<std::string> argNames;
+	std::vector<SourceLoc> argLocs;
 	std::vector<std::shared_ptr<TypeAST>> typeNames;
 	current++; // Consume the ( and begin parsing the args
 
 	while (current->type == TokenType::IDENTIFIER) {
 		argNames.push_back(current->lexeme);
+		argLocs.push_back(current->loc);
 		current++; // Consume the IDENTIFIER arg name
 
 		auto type = parseType(); // Consumes IDENTIFIERs for the type
@@ -472,8 +849,6 @@ std::optional<std::shared_ptr<PrototypeAST>> Parser::parsePrototype() {
 
 	current++;
 	auto retType = parseType();
-	std::cout << "Ret type " << retType.value()->data << " for func " << name
-			  << std::endl;
 	if (!retType) {
 		LogError("Unable to parse return type of function", "E0111");
 		return std::nullopt;
@@ -482,14 +857,15 @@ std::optional<std::shared_ptr<PrototypeAST>> Parser::parsePrototype() {
 	std::vector<std::shared_ptr<ParameterAST>> params;
 	for (int i = 0; i < argNames.size(); ++i) {
 		params.push_back(
-			std::make_shared<ParameterAST>(argNames[i], typeNames[i]));
+			make<ParameterAST>(argLocs[i], argNames[i], typeNames[i]));
 	}
 
-	return std::make_shared<PrototypeAST>(name, std::move(params),
-										  std::move(retType.value()));
+	return make<PrototypeAST>(loc, name, std::move(params),
+							  std::move(retType.value()));
 }
 
 std::optional<std::shared_ptr<FunctionAST>> Parser::parseDefinition() {
+	SourceLoc loc = current->loc;
 	current++;
 	auto proto = parsePrototype();
 	if (!proto) return std::nullopt;
@@ -497,42 +873,150 @@ std::optional<std::shared_ptr<FunctionAST>> Parser::parseDefinition() {
 	auto expr = parseBlock();
 	if (!expr) return std::nullopt;
 
-	return std::make_shared<FunctionAST>(std::move(proto.value()),
-										 std::move(expr.value()));
+	return make<FunctionAST>(loc, std::move(proto.value()),
+							 std::move(expr.value()));
+}
+
+std::vector<Attribute> Parser::parseAttributes() {
+	std::vector<Attribute> attributes;
+	// on a malformed attribute skip to its closing ] and carry on, so one
+	// typo does not take the item it is attached to down with it
+	auto recover = [&] {
+		while (current->type != TokenType::RIGHT_SQUARE_BRACKET &&
+			   current->type != TokenType::EOF_TOKEN)
+			current++;
+		if (current->type == TokenType::RIGHT_SQUARE_BRACKET) current++;
+	};
+
+	while (current->type == TokenType::HASH) {
+		Attribute attribute{.name = "", .args = {}, .loc = current->loc};
+		current++;
+
+		if (current->type != TokenType::LEFT_SQUARE_BRACKET) {
+			LogError("Expected '[' after '#'", "E0120");
+			continue;
+		}
+		current++;
+
+		if (current->type != TokenType::IDENTIFIER) {
+			LogError("Expected attribute name", "E0121");
+			recover();
+			continue;
+		}
+		attribute.name = current->lexeme;
+		current++;
+
+		bool ok = true;
+		if (current->type == TokenType::LEFT_PAREN) {
+			current++;
+			while (current->type != TokenType::RIGHT_PAREN) {
+				Attribute::Arg arg;
+				if (current->type == TokenType::IDENTIFIER &&
+					(current + 1)->type == TokenType::EQUAL) {
+					arg.key = current->lexeme;
+					current += 2;
+				}
+
+				switch (current->type) {
+				case TokenType::IDENTIFIER:
+				case TokenType::NUMBER:
+					arg.value = current->lexeme;
+					break;
+				case TokenType::STRING:
+					arg.value = current->lexeme.substr(
+						1, current->lexeme.length() - 2);
+					break;
+				default:
+					ok = false;
+					break;
+				}
+				if (!ok) break;
+				current++;
+				attribute.args.push_back(std::move(arg));
+
+				if (current->type != TokenType::COMMA) break;
+				current++;
+			}
+
+			if (!ok || current->type != TokenType::RIGHT_PAREN) {
+				LogError("Expected a name, number or string as the argument",
+						 "E0122");
+				recover();
+				continue;
+			}
+			current++;
+		}
+
+		if (current->type != TokenType::RIGHT_SQUARE_BRACKET) {
+			LogError("Expected ']' to close the attribute", "E0123");
+			recover();
+			continue;
+		}
+		current++;
+
+		attributes.push_back(std::move(attribute));
+	}
+
+	return attributes;
 }
 
 std::optional<std::shared_ptr<ReturnStmt>> Parser::parseReturnStmt() {
+	SourceLoc loc = current->loc;
 	current++;
 
 	if (current->type == TokenType::SEMICOLON) {
 		current++;
-		return std::make_shared<ReturnStmt>(std::nullopt);
+		return make<ReturnStmt>(loc, std::nullopt);
 	}
 
 	auto expr = parseExpression();
 	// if (!expr) return std::nullopt;
 	current++;
-	return std::make_shared<ReturnStmt>(std::move(expr));
+	return make<ReturnStmt>(loc, std::move(expr));
 }
 
 FileAST *Parser::parse() {
 	std::vector<std::shared_ptr<AST>> fileNodes;
+	// attributes seen so far, for the item that comes next
+	std::vector<Attribute> attributes;
 	while (true) {
+		if (diagnostics.shouldAbort()) break;
+
 		switch (current->type) {
-		case TokenType::EOF_TOKEN:
-			return new FileAST("test", std::move(fileNodes));
+		case TokenType::EOF_TOKEN: {
+			auto file = new FileAST("test", std::move(fileNodes));
+			file->loc = SourceLoc::get(current->loc.file(), 0);
+			return file;
+		}
 		case TokenType::SEMICOLON:
 			current++;
 			break;
+		case TokenType::HASH: {
+			auto more = parseAttributes();
+			attributes.insert(attributes.end(), more.begin(), more.end());
+		} break;
 		case TokenType::FUNC: {
 			auto definition = parseDefinition();
 			if (!definition) continue;
+			// function attributes describe the signature, so declarations
+			// carry them too
+			definition.value()->proto->attributes = std::move(attributes);
+			attributes.clear();
 			fileNodes.push_back(std::move(definition.value()));
 		} break;
 		case TokenType::STRUCT: {
 			auto def = parseStruct();
+			def.value()->attributes = std::move(attributes);
+			attributes.clear();
 			fileNodes.push_back(std::move(def.value()));
 		} break;
+		case TokenType::CONST: {
+			auto decl = parseConst();
+			if (!decl) continue;
+			decl.value()->attributes = std::move(attributes);
+			attributes.clear();
+			fileNodes.push_back(std::move(decl.value()));
+		} break;
 		default: {
 			LogError(fmt::format("Unexpected character '{}'", current->lexeme),
 					 "E0010");
@@ -540,35 +1024,31 @@ FileAST *Parser::parse() {
 		} break;
 		}
 	}
+
+	// gave up early, hand back what was parsed so far so later phases still
+	// have a tree to look at
+	return new FileAST("test", std::move(fileNodes));
 }
 
 void Parser::LogError(std::string message, std::string code) {
-	std::cout << "Error " << code << ": " << message << " on line "
-			  << current->line << std::endl;
-	messages.push_back(
+	diagnostics.report(
 		Message{.message = message,
 				.level = Severity::Error,
 				.code = code,
 				.span = Location{
-					.fp = current->fp,
-					.line = current->line,
-					.column = current->column - current->lexeme.length(),
-					.start = current->char_start - current->lexeme.length(),
-					.end = current->char_start,
+					.loc = current->loc,
+					.length = (uint32_t)current->lexeme.length(),
 				}});
 }
 
 void Parser::LogWarning(std::string message, std::string code) {
-	messages.push_back(
+	diagnostics.report(
 		Message{.message = message,
 				.level = Severity::Warning,
 				.code = code,
 				.span = Location{
-					.fp = current->fp,
-					.line = current->line,
-					.column = current->column - current->lexeme.length(),
-					.start = current->char_start - current->lexeme.length(),
-					.end = current->char_start,
+					.loc = current->loc,
+					.length = (uint32_t)current->lexeme.length(),
 				}});
 }
 } // namespace FoxLang
@@ -1,47 +1,70 @@
 #pragma once
 
 #include "ast_nodes.hpp"
-#include "message.hpp"
+#include "diagnostics.hpp"
 
-#include <deque>
+#include <cstdint>
 #include <memory>
+#include <optional>
+#include <string_view>
 
 namespace FoxLang {
 class Parser {
 public:
-	Parser(std::vector<Token> *tokens, std::deque<Message> &messages)
-		: current(tokens->begin()), messages(messages) {}
+	Parser(std::vector<Token> *tokens, Diagnostics &diagnostics)
+		: current(tokens->begin()), diagnostics(diagnostics) {}
 
 	FileAST *parse();
 
 private:
 	std::vector<Token>::iterator current;
-	std::deque<Message> &messages;
+	Diagnostics &diagnostics;
 
 private:
 	std::optional<std::shared_ptr<ExprAST>> parseNumberExpr();
 	std::optional<std::shared_ptr<ExprAST>> parseParenExpr();
 	std::optional<std::shared_ptr<ExprAST>> parseIdentifierExpr();
+	std::optional<std::shared_ptr<ExprAST>>
+	parseLayoutExpr(LayoutExprAST::Query query, SourceLoc loc);
 	std::optional<std::shared_ptr<ExprAST>> parsePrimary();
 	std::optional<std::shared_ptr<ExprAST>> parseExpression();
 	std::optional<std::shared_ptr<StmtAST>> parseStatement();
 	std::optional<std::shared_ptr<StructLiteralAST>> parseStructInstance();
-	std::optional<std::shared_ptr<ExprStmt>> parseExprStatement();
+	std::optional<std::shared_ptr<ExprAST>> parseArrayLiteral();
+	std::optional<std::shared_ptr<ExprAST>> parseRefExpr();
+	std::optional<std::shared_ptr<ExprAST>>
+	parseIndex(std::optional<std::shared_ptr<ExprAST>> array);
+	std::optional<std::shared_ptr<StmtAST>> parseExprStatement();
+	std::optional<std::shared_ptr<StmtAST>>
+	parseAssign(std::shared_ptr<ExprAST> target);
 	std::optional<std::shared_ptr<BlockAST>> parseBlock();
 	std::optional<std::shared_ptr<BlockAST>> parseBklessBlock();
 	std::optional<std::shared_ptr<VarDecl>> parseLet();
+	std::optional<std::shared_ptr<VarDecl>> parseConst();
 	std::optional<std::shared_ptr<IfStmt>> parseIfStmt();
 	std::optional<std::shared_ptr<WhileStmt>> parseWhileStmt();
+	std::optional<std::shared_ptr<ForStmt>> parseForStmt();
 	std::optional<std::shared_ptr<TypeAST>> parseType();
+	/// Parses `[N]` from the opening bracket on
+	std::optional<uint64_t> parseLength(std::string_view what);
 	std::optional<std::shared_ptr<StructAST>> parseStruct();
 	std::optional<std::shared_ptr<PrototypeAST>> parsePrototype();
 	std::optional<std::shared_ptr<FunctionAST>> parseDefinition();
 	std::optional<std::shared_ptr<ReturnStmt>> parseReturnStmt();
+	std::vector<Attribute> parseAttributes();
 
 	std::optional<std::shared_ptr<ExprAST>>
 	parseBinOpRHS(int, std::optional<std::shared_ptr<ExprAST>>);
 
 	void LogError(std::string message, std::string code);
 	void LogWarning(std::string message, std::string code);
+
+	/// Builds an AST node stamped with the location it started at
+	template <typename T, typename... Args>
+	std::shared_ptr<T> make(SourceLoc loc, Args &&...args) {
+		auto node = std::make_shared<T>(std::forward<Args>(args)...);
+		node->loc = loc;
+		return node;
+	}
 };
 } // namespace FoxLang
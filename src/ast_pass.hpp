@@ -12,15 +12,23 @@ public:
 	virtual void visit(StringLiteralAST &it) = 0;
 	virtual void visit(BoolLiteralAST &it) = 0;
 	virtual void visit(StructLiteralAST &it) = 0;
+	virtual void visit(ArrayLiteralAST &it) = 0;
 	virtual void visit(VariableExprAST &it) = 0;
+	virtual void visit(IndexExprAST &it) = 0;
+	virtual void visit(RefExprAST &it) = 0;
+	virtual void visit(DerefExprAST &it) = 0;
+	virtual void visit(StructMemberAccessAST &it) = 0;
+	virtual void visit(LayoutExprAST &it) = 0;
 	virtual void visit(FileAST &it) = 0;
 	virtual void visit(ParameterAST &it) = 0;
 	virtual void visit(FunctionAST &it) = 0;
 	virtual void visit(PrototypeAST &it) = 0;
 	virtual void visit(ExprStmt &it) = 0;
+	virtual void visit(AssignStmt &it) = 0;
 	virtual void visit(ReturnStmt &it) = 0;
 	virtual void visit(IfStmt &it) = 0;
 	virtual void visit(WhileStmt &it) = 0;
+	virtual void visit(ForStmt &it) = 0;
 	virtual void visit(VarDecl &it) = 0;
 	virtual void visit(TypeAST &it) = 0;
 	virtual void visit(StructMemberAST &it) = 0;
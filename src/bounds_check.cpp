@@ -0,0 +1,279 @@
+#include "bounds_check.hpp"
+
+#include <llvm/ADT/StringRef.h>
+
+namespace FoxLang {
+// every node below `node`, statements and expressions alike
+static void collect(AST *node, std::vector<AST *> &out) {
+	for (auto child : node->getChildren()) {
+		if (child == nullptr) continue;
+		out.push_back(child);
+		collect(child, out);
+	}
+}
+
+static AST *assigned(AssignStmt &it) {
+	auto v = it.variable();
+	return v ? v->resolved_name : nullptr;
+}
+
+std::optional<uint64_t> BoundsCheck::constant(ExprAST &expr) {
+	if (auto number = dynamic_cast<NumberExprAST *>(&expr)) {
+		uint64_t value;
+		if (llvm::StringRef(number->value).getAsInteger(10, value))
+			return std::nullopt;
+		return value;
+	}
+
+	auto variable = dynamic_cast<VariableExprAST *>(&expr);
+	auto decl = variable ? dynamic_cast<VarDecl *>(variable->resolved_name)
+						 : nullptr;
+	if (decl == nullptr) return std::nullopt;
+
+	if (decl->folded && decl->folded->isInt()) {
+		auto &i = decl->folded->getInt();
+		if (i.is_signed && i.value.isNegative()) return std::nullopt;
+		if (i.value.getActiveBits() > 64) return std::nullopt;
+		return i.value.getZExtValue();
+	}
+
+	// a plain `let` never changes, so it is as good as its initializer
+	if (!decl->mut && !decl->constant && decl->value)
+		return constant(*decl->value.value());
+	return std::nullopt;
+}
+
+void BoundsCheck::learn(ExprAST &condition) {
+	auto binary = dynamic_cast<BinaryExprAST *>(&condition);
+	if (binary == nullptr) return;
+
+	if (binary->Op.type == TokenType::AND) {
+		learn(*binary->LHS);
+		learn(*binary->RHS);
+		return;
+	}
+
+	// `i < n` and `n > i` bound i by n, the `=` forms by one more
+	ExprAST *variable = nullptr, *limit = nullptr;
+	bool inclusive = false;
+	switch (binary->Op.type) {
+	case TokenType::LESS_EQUAL:
+		inclusive = true;
+		[[fallthrough]];
+	case TokenType::LESS:
+		variable = binary->LHS.get();
+		limit = binary->RHS.get();
+		break;
+	case TokenType::GREATER_EQUAL:
+		inclusive = true;
+		[[fallthrough]];
+	case TokenType::GREATER:
+		variable = binary->RHS.get();
+		limit = binary->LHS.get();
+		break;
+	default:
+		return;
+	}
+
+	auto v = dynamic_cast<VariableExprAST *>(variable);
+	if (v == nullptr || v->resolved_name == nullptr) return;
+	if (borrowed.contains(v->resolved_name)) return;
+	if (v->checked_type == nullptr || !v->checked_type->isInteger()) return;
+
+	auto k = constant(*limit);
+	if (!k || (inclusive && *k == UINT64_MAX)) return;
+	uint64_t bound = *k + inclusive;
+
+	auto known = bounds.find(v->resolved_name);
+	if (known == bounds.end() || bound < known->second)
+		bounds[v->resolved_name] = bound;
+}
+
+void BoundsCheck::forget(AST &node) {
+	std::vector<AST *> nodes;
+	collect(&node, nodes);
+	for (auto n : nodes)
+		if (auto assign = dynamic_cast<AssignStmt *>(n))
+			bounds.erase(assigned(*assign));
+}
+
+void BoundsCheck::visit(FileAST &it) {
+	for (auto i : it.expressions)
+		if (auto f = dynamic_cast<FunctionAST *>(i.get())) f->accept(*this);
+}
+
+void BoundsCheck::visit(FunctionAST &it) {
+	std::vector<AST *> nodes;
+	collect(it.body.get(), nodes);
+
+	borrowed.clear();
+	for (auto n : nodes)
+		if (auto ref = dynamic_cast<RefExprAST *>(n); ref && ref->mut)
+			borrowed.insert(RefExprAST::borrowed(*ref));
+
+	// a signed local is never negative when it starts at a constant and is
+	// only ever set to one, or counted up by a constant while overflow cannot
+	// wrap
+	nonnegative.clear();
+	for (auto n : nodes) {
+		auto decl = dynamic_cast<VarDecl *>(n);
+		if (decl != nullptr && decl->type->isSigned() && decl->value &&
+			constant(*decl->value.value()))
+			nonnegative.insert(decl);
+	}
+
+	for (auto n : nodes) {
+		auto assign = dynamic_cast<AssignStmt *>(n);
+		if (assign == nullptr) continue;
+
+		auto decl = assigned(*assign);
+		if (!nonnegative.contains(decl)) continue;
+		if (dynamic_cast<VariableExprAST *>(assign->target.get()) == nullptr ||
+			constant(*assign->value))
+			continue;
+
+		auto sum = dynamic_cast<BinaryExprAST *>(assign->value.get());
+		bool counts = false;
+		if (!wrapping && sum != nullptr && sum->Op.type == TokenType::PLUS) {
+			auto l = dynamic_cast<VariableExprAST *>(sum->LHS.get());
+			auto r = dynamic_cast<VariableExprAST *>(sum->RHS.get());
+			counts = (l && l->resolved_name == decl && constant(*sum->RHS)) ||
+					 (r && r->resolved_name == decl && constant(*sum->LHS));
+		}
+		if (!counts) nonnegative.erase(decl);
+	}
+	for (auto decl : borrowed)
+		nonnegative.erase(decl);
+
+	bounds.clear();
+	it.body->accept(*this);
+}
+
+void BoundsCheck::visit(IndexExprAST &it) {
+	it.array->accept(*this);
+	it.index->accept(*this);
+
+	auto array = it.array->checked_type;
+	if (array == nullptr ||
+		(array->type != TypeAST::Type::array && !array->isVector()))
+		return;
+
+	if (auto k = constant(*it.index); k && *k < array->length) {
+		it.checked = false;
+		return;
+	}
+
+	auto v = dynamic_cast<VariableExprAST *>(it.index.get());
+	if (v != nullptr && v->checked_type != nullptr &&
+		(!v->checked_type->isSigned() ||
+		 nonnegative.contains(v->resolved_name))) {
+		auto known = bounds.find(v->resolved_name);
+		if (known != bounds.end() && known->second <= array->length) {
+			it.checked = false;
+			return;
+		}
+	}
+
+	kept.push_back(&it);
+}
+
+void BoundsCheck::visit(AssignStmt &it) {
+	it.target->accept(*this);
+	it.value->accept(*this);
+	bounds.erase(assigned(it));
+}
+
+void BoundsCheck::visit(IfStmt &it) {
+	it.condition->accept(*this);
+
+	auto before = bounds;
+	learn(*it.condition);
+	it.block->accept(*this);
+	bounds = before;
+
+	if (it.else_) {
+		it.else_.value()->accept(*this);
+		bounds = before;
+	}
+	forget(it);
+}
+
+void BoundsCheck::visit(WhileStmt &it) {
+	// the loop comes back around after its body, so nothing assigned in it
+	// holds on entry, not even in the condition
+	forget(it);
+	it.condition->accept(*this);
+
+	auto before = bounds;
+	learn(*it.condition);
+	it.block->accept(*this);
+	bounds = before;
+}
+
+void BoundsCheck::visit(ForStmt &it) {
+	for (auto child : it.getChildren())
+		if (child != it.block.get()) child->accept(*this);
+	forget(it);
+
+	// the loop variable runs from the start of the range up to its end, and
+	// a constant start is never negative
+	auto before = bounds;
+	if (it.end)
+		if (auto k = constant(*it.end)) bounds[it.variable.get()] = *k;
+	if (it.start && constant(*it.start)) nonnegative.insert(it.variable.get());
+	it.block->accept(*this);
+	bounds = before;
+}
+
+void BoundsCheck::visit(BlockAST &it) {
+	for (auto i : it.content)
+		i->accept(*this);
+}
+
+void BoundsCheck::visit(BinaryExprAST &it) {
+	it.LHS->accept(*this);
+	it.RHS->accept(*this);
+}
+
+void BoundsCheck::visit(CallExprAST &it) {
+	for (auto i : it.Args)
+		i->accept(*this);
+}
+
+void BoundsCheck::visit(StructLiteralAST &it) {
+	for (auto i : it.values)
+		i->accept(*this);
+}
+
+void BoundsCheck::visit(ArrayLiteralAST &it) {
+	for (auto i : it.elements)
+		i->accept(*this);
+}
+
+void BoundsCheck::visit(RefExprAST &it) { it.target->accept(*this); }
+void BoundsCheck::visit(DerefExprAST &it) { it.pointer->accept(*this); }
+void BoundsCheck::visit(StructMemberAccessAST &it) {
+	it.parent->accept(*this);
+}
+
+void BoundsCheck::visit(ExprStmt &it) { it.value->accept(*this); }
+
+void BoundsCheck::visit(ReturnStmt &it) {
+	if (it.value) it.value.value()->accept(*this);
+}
+
+void BoundsCheck::visit(VarDecl &it) {
+	if (it.value) it.value.value()->accept(*this);
+}
+
+void BoundsCheck::visit(NumberExprAST &) {}
+void BoundsCheck::visit(StringLiteralAST &) {}
+void BoundsCheck::visit(BoolLiteralAST &) {}
+void BoundsCheck::visit(VariableExprAST &) {}
+void BoundsCheck::visit(LayoutExprAST &) {}
+void BoundsCheck::visit(ParameterAST &) {}
+void BoundsCheck::visit(PrototypeAST &) {}
+void BoundsCheck::visit(TypeAST &) {}
+void BoundsCheck::visit(StructMemberAST &) {}
+void BoundsCheck::visit(StructAST &) {}
+} // namespace FoxLang
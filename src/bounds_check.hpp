@@ -0,0 +1,75 @@
+#pragma once
+
+#include "ast_nodes.hpp"
+#include "ast_pass.hpp"
+
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <set>
+#include <vector>
+
+namespace FoxLang {
+/// BoundsCheck - Finds array indexing that can never go out of bounds and
+/// clears IndexExprAST::checked on it, so no check is generated. An index is
+/// in bounds when it is a constant smaller than the length, or a variable
+/// that an enclosing `while` or `if` compared against such a constant and
+/// that has not been assigned since, or the variable of a `for` over a range
+/// ending at one. Signed variables also have to be known not to go below
+/// zero. Runs after TypeCheck and ConstEval.
+class BoundsCheck : public ASTVisitor {
+public:
+	/// `wrapping` is whether integer overflow wraps around, a signed counter
+	/// that only ever grows can then still turn negative
+	BoundsCheck(bool wrapping) : wrapping(wrapping) {}
+
+	/// Indexing that still needs a check, in source order, for reporting
+	std::vector<IndexExprAST *> kept;
+
+	virtual void visit(BlockAST &it);
+	virtual void visit(BinaryExprAST &it);
+	virtual void visit(CallExprAST &it);
+	virtual void visit(NumberExprAST &it);
+	virtual void visit(StringLiteralAST &it);
+	virtual void visit(BoolLiteralAST &it);
+	virtual void visit(StructLiteralAST &it);
+	virtual void visit(ArrayLiteralAST &it);
+	virtual void visit(VariableExprAST &it);
+	virtual void visit(IndexExprAST &it);
+	virtual void visit(RefExprAST &it);
+	virtual void visit(DerefExprAST &it);
+	virtual void visit(StructMemberAccessAST &it);
+	virtual void visit(LayoutExprAST &it);
+	virtual void visit(FileAST &it);
+	virtual void visit(ParameterAST &it);
+	virtual void visit(FunctionAST &it);
+	virtual void visit(PrototypeAST &it);
+	virtual void visit(ExprStmt &it);
+	virtual void visit(AssignStmt &it);
+	virtual void visit(ReturnStmt &it);
+	virtual void visit(IfStmt &it);
+	virtual void visit(WhileStmt &it);
+	virtual void visit(ForStmt &it);
+	virtual void visit(VarDecl &it);
+	virtual void visit(TypeAST &it);
+	virtual void visit(StructMemberAST &it);
+	virtual void visit(StructAST &it);
+
+private:
+	bool wrapping;
+
+	// exclusive upper bound known for a variable at the current point
+	std::map<AST *, uint64_t> bounds;
+	// signed variables of the current function that are never negative
+	std::set<AST *> nonnegative;
+	// variables of the current function a `&mut` is taken of, which can
+	// change without any assignment naming them
+	std::set<AST *> borrowed;
+
+	std::optional<uint64_t> constant(ExprAST &expr);
+	/// Records the bounds that hold whenever `condition` is true
+	void learn(ExprAST &condition);
+	/// Drops what is known about every variable assigned inside `node`
+	void forget(AST &node);
+};
+} // namespace FoxLang
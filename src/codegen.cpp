@@ -0,0 +1,191 @@
+#include "codegen.hpp"
+
+#include "../vendor/bs_thread_pool/BS_thread_pool.hpp"
+
+#include <fmt/format.h>
+#include <llvm/Config/llvm-config.h>
+#include <llvm/IR/CFG.h>
+#include <llvm/IR/DiagnosticHandler.h>
+#include <llvm/IR/DiagnosticInfo.h>
+#include <llvm/IR/LegacyPassManager.h>
+#include <llvm/Support/raw_ostream.h>
+#include <set>
+
+namespace FoxLang {
+namespace {
+/// HintHandler - Turns the warnings llvm gives about loop hints it could not
+/// honor into diagnostics at the loop. Everything else goes on to llvm's own
+/// handler.
+class HintHandler : public llvm::DiagnosticHandler {
+public:
+	HintHandler(Diagnostics &diagnostics, const IR::Generator &ir)
+		: diagnostics(diagnostics), ir(ir) {}
+
+	bool handleDiagnostics(const llvm::DiagnosticInfo &info) override {
+		if (info.getKind() != llvm::DK_OptimizationFailure) return false;
+		auto &failure =
+			llvm::cast<llvm::DiagnosticInfoOptimizationFailure>(info);
+
+		// the failure is about the loop whose header it points at, and the
+		// latch branching back there carries the loop id
+		SourceLoc loc;
+		auto header = llvm::dyn_cast_or_null<llvm::BasicBlock>(
+			failure.getCodeRegion());
+		if (header)
+			for (auto latch : llvm::predecessors(header)) {
+				auto id = latch->getTerminator()->getMetadata(
+					llvm::LLVMContext::MD_loop);
+				if (auto loop = ir.hinted_loops.find(id);
+					loop != ir.hinted_loops.end())
+					loc = loop->second;
+			}
+
+		// clones made for multiversioning are named after the function with
+		// a suffix
+		auto name = failure.getFunction().getName().split('.').first.str();
+
+		// every clone fails the same way
+		auto message = fmt::format("loop hint in `{}` was not honored: {}",
+								   name, failure.getMsg());
+		if (!reported.insert({loc, message}).second) return true;
+
+		diagnostics.report(Message{.message = std::move(message),
+								   .level = Severity::Warning,
+								   .code = "W0600",
+								   .span = Location{.loc = loc, .length = 1}});
+		return true;
+	}
+
+private:
+	Diagnostics &diagnostics;
+	const IR::Generator &ir;
+	std::set<std::pair<SourceLoc, std::string>> reported;
+};
+} // namespace
+
+std::vector<Partition> CodeGen::run(FileAST &file) {
+	std::vector<const FunctionAST *> functions;
+	for (auto child : file.getChildren())
+		if (auto f = dynamic_cast<FunctionAST *>(child); f && f->used)
+			functions.push_back(f);
+
+	size_t units = options.units == 0 ? functions.size() : options.units;
+	units = std::max<size_t>(1, std::min(units, functions.size()));
+
+	// contiguous runs in source order, the first partitions take one extra
+	// function each when the count does not divide evenly
+	std::vector<std::set<const FunctionAST *>> owned(units);
+	size_t per = functions.size() / units, extra = functions.size() % units;
+	for (size_t i = 0, next = 0; i < units; i++) {
+		size_t count = per + (i < extra ? 1 : 0);
+		owned[i].insert(functions.begin() + next,
+						functions.begin() + next + count);
+		next += count;
+	}
+
+	std::vector<Partition> partitions(units);
+
+	unsigned jobs = options.jobs == 0 ? std::thread::hardware_concurrency()
+									  : options.jobs;
+	jobs = std::max(1u, std::min<unsigned>(jobs, units));
+
+	// everything besides the module itself that changes the machine code
+	auto salt = fmt::format(
+		"fox 0.0.1 {}\n{}\n{}\n{}\n{}\n{}\n{}\n{}", LLVM_VERSION_STRING,
+		target.getTriple(), target.getCPU(), target.getFeatures(),
+		static_cast<int>(options.optimize.level), options.optimize.passes,
+		static_cast<int>(options.overflow), static_cast<int>(options.fp_mode));
+
+	auto generate = [&](size_t i) {
+		auto &partition = partitions[i];
+		auto machine = target.createMachine(options.optimize.level);
+
+		auto name = units == 1 ? options.name
+							   : fmt::format("{}.{}", options.name, i);
+		partition.ir =
+			std::make_unique<IR::Generator>(name, std::move(owned[i]), i == 0);
+		partition.ir->overflow = options.overflow;
+		partition.ir->fp_mode = options.fp_mode;
+		partition.ir->ifuncs = options.ifuncs;
+		partition.ir->diagnostics = options.diagnostics;
+		auto &module = *partition.ir->llvm_module;
+		module.setSourceFileName(options.name);
+		module.setTargetTriple(target.getTriple());
+		module.setDataLayout(machine->createDataLayout());
+
+		file.accept(*partition.ir);
+		if (partition.ir->broken) return;
+
+		// every partition declares every function, drop the ones it never
+		// calls so they do not end up in its object or its cache key
+		for (auto &f : llvm::make_early_inc_range(module))
+			if (f.isDeclaration() && f.use_empty()) f.eraseFromParent();
+
+		// the machine already knows the cpu, but bitcode handed on to other
+		// llvm tools only keeps it through the function attributes
+		for (auto &f : module) {
+			if (f.isDeclaration()) continue;
+			if (!f.hasFnAttribute("target-cpu"))
+				f.addFnAttr("target-cpu", target.getCPU());
+			// multiversioned clones come with features of their own, which
+			// go on top of the module's
+			auto features = target.getFeatures();
+			if (f.hasFnAttribute("target-features")) {
+				auto own = f.getFnAttribute("target-features");
+				features = features.empty()
+							   ? own.getValueAsString().str()
+							   : fmt::format("{},{}", features,
+											 own.getValueAsString().str());
+			}
+			if (!features.empty()) f.addFnAttr("target-features", features);
+		}
+
+		// a loop hint llvm does not honor is only reported by the optimizer,
+		// so partitions with hints skip the cache to keep their warnings
+		std::string key;
+		bool hinted = options.diagnostics != nullptr &&
+					  !partition.ir->hinted_loops.empty();
+		if (options.objects && options.cache != nullptr && !hinted) {
+			key = ObjectCache::key(module, salt);
+			if (options.cache->lookup(key, partition.object)) {
+				partition.cached = true;
+				return;
+			}
+		}
+
+		if (options.diagnostics != nullptr)
+			module.getContext().setDiagnosticHandler(
+				std::make_unique<HintHandler>(*options.diagnostics,
+											  *partition.ir));
+
+		Optimizer optimizer(options.optimize);
+		optimizer.run(module, machine.get());
+		partition.timings = std::move(optimizer.timings);
+
+		if (options.objects) {
+			llvm::raw_svector_ostream os(partition.object);
+			llvm::legacy::PassManager pm;
+			machine->addPassesToEmitFile(pm, os, nullptr,
+										 llvm::CodeGenFileType::ObjectFile);
+			pm.run(module);
+
+			if (!key.empty()) options.cache->store(key, partition.object);
+		}
+	};
+
+	if (jobs == 1) {
+		for (size_t i = 0; i < units; i++)
+			generate(i);
+	} else {
+		BS::thread_pool<> pool(jobs);
+		pool.submit_sequence<size_t>(0, units, generate).wait();
+	}
+
+	// merged in partition order so the report lists passes the same way
+	// every run
+	for (auto &partition : partitions)
+		Optimizer::merge(timings, partition.timings);
+
+	return partitions;
+}
+} // namespace FoxLang
@@ -0,0 +1,72 @@
+#pragma once
+
+#include "ast_nodes.hpp"
+#include "diagnostics.hpp"
+#include "ir_generator.hpp"
+#include "object_cache.hpp"
+#include "optimizer.hpp"
+#include "target.hpp"
+
+#include <llvm/ADT/SmallVector.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace FoxLang {
+/// Partition - One of the modules a program is split into for code
+/// generation, and everything produced for it on its worker thread.
+struct Partition {
+	std::unique_ptr<IR::Generator> ir;
+	std::vector<Optimizer::Timing> timings;
+	// machine code for the module, when objects were asked for
+	llvm::SmallVector<char, 0> object;
+	// the object came out of the cache, so the module was never optimized
+	bool cached = false;
+};
+
+/// CodeGen - Splits the functions of a program into partitions and lowers
+/// each one into its own module on a thread pool. Partitions only depend on
+/// the source order of the functions and the requested unit count, never on
+/// the number of threads, so the output is the same however many jobs run.
+class CodeGen {
+public:
+	struct Options {
+		// prefix for the module names, usually the source path
+		std::string name;
+		// number of partitions, 0 for one per function
+		unsigned units = 0;
+		// worker threads, 0 for one per core
+		unsigned jobs = 0;
+		Optimizer::Options optimize;
+		IR::Generator::Overflow overflow = IR::Generator::Overflow::Undefined;
+		IR::Generator::FPMode fp_mode = IR::Generator::FPMode::Strict;
+		// false when the code is not loaded by the dynamic loader, like in
+		// the jit
+		bool ifuncs = true;
+		// also compile every partition to an object file in memory
+		bool objects = false;
+		// reuse objects from earlier builds, only used with objects. Never
+		// used for partitions with loop hints while diagnostics are wanted
+		ObjectCache *cache = nullptr;
+		// gets the errors lowering runs into and the loop hints llvm could
+		// not honor
+		Diagnostics *diagnostics = nullptr;
+	};
+
+	CodeGen(Options options, const Target &target)
+		: options(std::move(options)), target(target) {}
+
+	/// Lowers and optimizes every used function and struct in the file. The
+	/// first partition is the primary one and also holds the module level
+	/// data.
+	std::vector<Partition> run(FileAST &file);
+
+	/// Pass timings of every partition added together, when asked for
+	std::vector<Optimizer::Timing> timings;
+
+private:
+	Options options;
+	const Target &target;
+};
+} // namespace FoxLang
@@ -0,0 +1,740 @@
+#include "const_eval.hpp"
+
+#include <fmt/format.h>
+#include <functional>
+#include <llvm/ADT/APFloat.h>
+#include <llvm/ADT/StringExtras.h>
+
+namespace FoxLang {
+void ConstEval::fail(AST &node, std::string message, std::string code) {
+	// only the first problem is interesting, everything after it is fallout
+	if (failed) return;
+	failed = true;
+
+	diagnostics.report(Message{.message = message,
+							   .level = Severity::Error,
+							   .code = code,
+							   .span = Location{.loc = node.loc, .length = 1}});
+}
+
+bool ConstEval::step(AST &node) {
+	if (failed) return false;
+
+	if (++steps > limits.steps) {
+		fail(node,
+			 fmt::format("constant evaluation took more than {} steps",
+						 limits.steps),
+			 "E0501");
+		return false;
+	}
+	return true;
+}
+
+void ConstEval::bind(AST *decl, ConstValue value) {
+	auto &frame = frames.back();
+	// an array given to a local declared without a value is bigger than
+	// the nothing it held before
+	if (auto old = frame.find(decl); old != frame.end())
+		memory -= old->second.footprint();
+	memory += value.footprint();
+	frame[decl] = std::move(value);
+
+	if (memory > limits.memory)
+		fail(*decl,
+			 fmt::format("constant evaluation used more than {} bytes",
+						 limits.memory),
+			 "E0505");
+}
+
+ConstValue ConstEval::eval(ExprAST &expr) {
+	value = ConstValue{};
+	if (step(expr)) expr.accept(*this);
+	return failed ? ConstValue{} : value;
+}
+
+// whether an unsized literal can be given the width and signedness
+static bool fits(const llvm::APInt &literal, unsigned bits, bool is_signed) {
+	return is_signed ? literal.getSignificantBits() <= bits
+					 : !literal.isNegative() && literal.getActiveBits() <= bits;
+}
+
+ConstValue ConstEval::convert(const ConstValue &v, TypeAST &type, AST &node) {
+	if (failed || v.empty()) return v;
+
+	if (type.isInteger() && v.isInt()) {
+		auto &i = v.getInt();
+		unsigned bits = type.bits();
+
+		// a literal only becomes a number of some width here, so this is the
+		// place to notice that it does not fit
+		if (!i.sized && !fits(i.value, bits, type.isSigned())) {
+			fail(node,
+				 fmt::format("{} does not fit in {}",
+							 llvm::toString(i.value, 10, true), type.data),
+				 "E0510");
+			return ConstValue{};
+		}
+
+		auto resized = i.is_signed ? i.value.sextOrTrunc(bits)
+								   : i.value.zextOrTrunc(bits);
+		return ConstValue{ConstValue::Int{resized, type.isSigned(), true}};
+	}
+
+	if (type.isFloat() && (v.isFloat() || (v.isInt() && !v.getInt().sized))) {
+		double d = v.isFloat() ? v.getFloat()
+							   : v.getInt().value.roundToDouble(true);
+		// a half has no c++ type of its own, it is rounded the way llvm
+		// rounds it when the constant ends up in the module
+		if (type.bits() == 16) {
+			llvm::APFloat half(d);
+			bool lost;
+			half.convert(llvm::APFloat::IEEEhalf(),
+						 llvm::APFloat::rmNearestTiesToEven, &lost);
+			half.convert(llvm::APFloat::IEEEdouble(),
+						 llvm::APFloat::rmNearestTiesToEven, &lost);
+			d = half.convertToDouble();
+		} else if (type.bits() <= 32)
+			d = (float)d;
+		return ConstValue{d};
+	}
+
+	if (type.type == TypeAST::Type::_bool && v.isBool()) return v;
+
+	// aggregates convert one element at a time, which is where a literal in
+	// an array literal finds out its type
+	using T = TypeAST::Type;
+	if ((type.type == T::array || type.isVector()) && v.isAggregate() &&
+		v.getAggregate().elements.size() == type.length) {
+		ConstValue::Aggregate result;
+		for (auto &element : v.getAggregate().elements)
+			result.elements.push_back(
+				convert(element, *type.child.value(), node));
+		return failed ? ConstValue{} : ConstValue{std::move(result)};
+	}
+
+	if (type.type == T::_struct && type.resolved_name && v.isAggregate() &&
+		v.getAggregate().elements.size() ==
+			type.resolved_name->members.size()) {
+		auto &members = type.resolved_name->members;
+		ConstValue::Aggregate result;
+		for (size_t i = 0; i < members.size(); i++)
+			result.elements.push_back(convert(v.getAggregate().elements[i],
+											  *members[i]->value, node));
+		return failed ? ConstValue{} : ConstValue{std::move(result)};
+	}
+
+	if (!type.isInteger() && !type.isFloat() && type.type != T::_bool &&
+		type.type != T::array && !type.isVector() && type.type != T::_struct)
+		fail(node,
+			 fmt::format("values of type {} cannot be computed at compile time",
+						 type.data),
+			 "E0509");
+	else
+		fail(node, fmt::format("value does not match type {}", type.data),
+			 "E0511");
+	return ConstValue{};
+}
+
+void ConstEval::evaluate(VarDecl &decl) {
+	if (decl.folded) return;
+
+	if (in_progress.contains(&decl)) {
+		fail(decl, fmt::format("const {} depends on itself", decl.name),
+			 "E0500");
+		return;
+	}
+
+	// a const never sees the locals of whoever asked for it
+	in_progress.insert(&decl);
+	auto saved = std::move(frames);
+	frames = {Frame()};
+
+	ConstValue v = eval(*decl.value.value());
+	v = convert(v, *decl.type, *decl.value.value());
+
+	for (auto &[_, val] : frames.back())
+		memory -= val.footprint();
+	frames = std::move(saved);
+	in_progress.erase(&decl);
+
+	if (!failed) decl.folded = v;
+}
+
+void ConstEval::visit(FileAST &it) {
+	std::vector<VarDecl *> consts;
+	std::vector<ForStmt *> ranges;
+	std::function<void(AST *)> collect = [&](AST *node) {
+		if (auto decl = dynamic_cast<VarDecl *>(node); decl && decl->constant)
+			consts.push_back(decl);
+		if (auto range = dynamic_cast<ForStmt *>(node); range && range->step)
+			ranges.push_back(range);
+		for (auto child : node->getChildren())
+			if (child != nullptr) collect(child);
+	};
+
+	for (auto i : it.expressions) {
+		if (auto fit = dynamic_cast<FunctionAST *>(i.get()))
+			functions[fit->proto.get()] = fit;
+		collect(i.get());
+	}
+
+	// each const gets its own chance to fail, one bad table should not hide
+	// the errors in the next
+	for (auto decl : consts) {
+		failed = false;
+		returning = false;
+		steps = 0;
+		evaluate(*decl);
+	}
+
+	// TypeCheck only knows a literal step of zero, a const one is only
+	// known now
+	for (auto range : ranges) {
+		auto variable =
+			dynamic_cast<VariableExprAST *>(range->step.value().get());
+		auto decl = variable ? dynamic_cast<VarDecl *>(variable->resolved_name)
+							 : nullptr;
+		if (decl == nullptr || !decl->folded || !decl->folded->isInt())
+			continue;
+
+		auto &step = decl->folded->getInt().value;
+		if (step.isZero() ||
+			(decl->folded->getInt().is_signed && step.isNegative())) {
+			failed = false;
+			fail(*variable, "the step of a range has to be positive", "E0516");
+		}
+	}
+}
+
+void ConstEval::visit(NumberExprAST &it) {
+	if (it.value.find('.') != std::string::npos) {
+		value = ConstValue{std::stod(it.value)};
+		return;
+	}
+
+	unsigned bits = std::max(64u, llvm::APInt::getBitsNeeded(it.value, 10) + 1);
+	value = ConstValue{
+		ConstValue::Int{llvm::APInt(bits, it.value, 10), true, false}};
+}
+
+void ConstEval::visit(BoolLiteralAST &it) { value = ConstValue{it.value}; }
+
+void ConstEval::visit(StringLiteralAST &it) {
+	fail(it, "strings cannot be used at compile time", "E0509");
+}
+
+void ConstEval::visit(StructLiteralAST &it) {
+	// TypeCheck made sure every member is given exactly once
+	auto &members = it.checked_type->resolved_name->members;
+	ConstValue::Aggregate result;
+	result.elements.resize(members.size());
+	for (size_t i = 0; i < it.values.size(); i++) {
+		auto field = it.fields[i];
+		result.elements[field] =
+			convert(eval(*it.values[i]), *members[field]->value, *it.values[i]);
+		if (failed) return;
+	}
+	value = ConstValue{std::move(result)};
+}
+
+void ConstEval::visit(ArrayLiteralAST &it) {
+	auto &element = *it.checked_type->child.value();
+	ConstValue::Aggregate result;
+	for (auto &e : it.elements) {
+		result.elements.push_back(convert(eval(*e), element, *e));
+		if (failed) return;
+	}
+	value = ConstValue{std::move(result)};
+}
+
+size_t ConstEval::index(IndexExprAST &it, const ConstValue &array) {
+	ConstValue i = eval(*it.index);
+	if (failed) return 0;
+
+	// unsized literals are signed, so a negative one is caught here too
+	auto &n = i.getInt();
+	auto length = array.getAggregate().elements.size();
+	if ((n.is_signed && n.value.isNegative()) || n.value.uge(length)) {
+		fail(it,
+			 fmt::format("index {} is out of bounds for {} elements",
+						 llvm::toString(n.value, 10, n.is_signed), length),
+			 "E0519");
+		return 0;
+	}
+	return n.value.getZExtValue();
+}
+
+void ConstEval::visit(IndexExprAST &it) {
+	ConstValue array = eval(*it.array);
+	if (failed) return;
+	auto i = index(it, array);
+	if (failed) return;
+	value = array.getAggregate().elements[i];
+}
+
+void ConstEval::visit(RefExprAST &it) {
+	fail(it, "references cannot be used at compile time", "E0517");
+}
+
+void ConstEval::visit(DerefExprAST &it) {
+	fail(it, "references cannot be used at compile time", "E0517");
+}
+
+void ConstEval::visit(StructMemberAccessAST &it) {
+	ConstValue parent = eval(*it.parent);
+	if (failed) return;
+	value = parent.getAggregate().elements[it.index];
+}
+
+void ConstEval::visit(LayoutExprAST &it) {
+	fail(it, "layouts are not known until the target is", "E0518");
+}
+
+void ConstEval::visit(VariableExprAST &it) {
+	if (!frames.empty()) {
+		auto &frame = frames.back();
+		if (auto found = frame.find(it.resolved_name); found != frame.end()) {
+			if (found->second.empty())
+				fail(it, fmt::format("{} is used before it is given a value",
+									 it.name),
+					 "E0507");
+			value = found->second;
+			return;
+		}
+	}
+
+	auto decl = dynamic_cast<VarDecl *>(it.resolved_name);
+	if (decl == nullptr || !decl->constant) {
+		fail(it, fmt::format("{} is not known at compile time", it.name),
+			 "E0506");
+		return;
+	}
+
+	evaluate(*decl);
+	if (decl->folded) value = decl->folded.value();
+}
+
+static ConstValue int_result(const ConstValue::Int &like, llvm::APInt v) {
+	return ConstValue{ConstValue::Int{v, like.is_signed, like.sized}};
+}
+
+void ConstEval::visit(BinaryExprAST &it) {
+	ConstValue l = eval(*it.LHS);
+	ConstValue r = eval(*it.RHS);
+	if (failed) return;
+
+	auto op = it.Op.type;
+
+	if (l.isBool() && r.isBool()) {
+		bool a = l.getBool(), b = r.getBool();
+		switch (op) {
+		case TokenType::AND:
+			value = ConstValue{a && b};
+			return;
+		case TokenType::OR:
+			value = ConstValue{a || b};
+			return;
+		case TokenType::EQUAL_EQUAL:
+			value = ConstValue{a == b};
+			return;
+		case TokenType::BANG_EQUAL:
+			value = ConstValue{a != b};
+			return;
+		default:
+			break;
+		}
+	}
+
+	// an unsized literal on either side takes the type of the other one
+	if (l.isInt() && r.isInt()) {
+		auto a = l.getInt(), b = r.getInt();
+		if ((a.sized && !b.sized &&
+			 !fits(b.value, a.value.getBitWidth(), a.is_signed)) ||
+			(b.sized && !a.sized &&
+			 !fits(a.value, b.value.getBitWidth(), b.is_signed))) {
+			fail(it, "literal does not fit in the type of the other operand",
+				 "E0510");
+			return;
+		}
+
+		if (a.sized && !b.sized) {
+			b = ConstValue::Int{b.value.sextOrTrunc(a.value.getBitWidth()),
+								a.is_signed, true};
+		} else if (b.sized && !a.sized) {
+			a = ConstValue::Int{a.value.sextOrTrunc(b.value.getBitWidth()),
+								b.is_signed, true};
+		} else if (a.value.getBitWidth() != b.value.getBitWidth()) {
+			unsigned bits =
+				std::max(a.value.getBitWidth(), b.value.getBitWidth());
+			a.value = a.value.sext(bits);
+			b.value = b.value.sext(bits);
+		}
+
+		bool s = a.is_signed, overflow = false;
+		switch (op) {
+		case TokenType::PLUS:
+			value = int_result(a, s ? a.value.sadd_ov(b.value, overflow)
+									: a.value.uadd_ov(b.value, overflow));
+			break;
+		case TokenType::MINUS:
+			value = int_result(a, s ? a.value.ssub_ov(b.value, overflow)
+									: a.value.usub_ov(b.value, overflow));
+			break;
+		case TokenType::STAR:
+			value = int_result(a, s ? a.value.smul_ov(b.value, overflow)
+									: a.value.umul_ov(b.value, overflow));
+			break;
+		case TokenType::SLASH:
+			if (b.value.isZero()) {
+				fail(it, "division by zero in constant expression", "E0512");
+				return;
+			}
+			value = int_result(a, s ? a.value.sdiv_ov(b.value, overflow)
+									: a.value.udiv(b.value));
+			break;
+		case TokenType::PERCENT:
+			if (b.value.isZero()) {
+				fail(it, "division by zero in constant expression", "E0512");
+				return;
+			}
+			value = int_result(a, s ? a.value.srem(b.value)
+									: a.value.urem(b.value));
+			break;
+		case TokenType::LEFT_SHIFT:
+		case TokenType::RIGHT_SHIFT: {
+			unsigned bits = a.value.getBitWidth();
+			overflow = b.value.uge(bits);
+			if (overflow) {
+				value = int_result(a, llvm::APInt(bits, 0));
+				break;
+			}
+			unsigned amount = b.value.getZExtValue();
+			if (op == TokenType::LEFT_SHIFT)
+				value = int_result(a, a.value.shl(amount));
+			else
+				value = int_result(a, s ? a.value.ashr(amount)
+										: a.value.lshr(amount));
+			break;
+		}
+		case TokenType::LESS:
+			value = ConstValue{s ? a.value.slt(b.value) : a.value.ult(b.value)};
+			break;
+		case TokenType::LESS_EQUAL:
+			value = ConstValue{s ? a.value.sle(b.value) : a.value.ule(b.value)};
+			break;
+		case TokenType::GREATER:
+			value = ConstValue{s ? a.value.sgt(b.value) : a.value.ugt(b.value)};
+			break;
+		case TokenType::GREATER_EQUAL:
+			value = ConstValue{s ? a.value.sge(b.value) : a.value.uge(b.value)};
+			break;
+		case TokenType::EQUAL_EQUAL:
+			value = ConstValue{a.value == b.value};
+			break;
+		case TokenType::BANG_EQUAL:
+			value = ConstValue{a.value != b.value};
+			break;
+		default:
+			fail(it,
+				 fmt::format("operator {} is not supported at compile time",
+							 it.Op.lexeme),
+				 "E0513");
+			return;
+		}
+
+		// unsized literals are only 64 bits here for convenience, the
+		// program never sees them overflow
+		if (overflow && a.sized)
+			fail(it, "arithmetic overflow in constant expression", "E0514");
+		return;
+	}
+
+	if ((l.isFloat() || l.isInt()) && (r.isFloat() || r.isInt()) &&
+		(l.isFloat() || r.isFloat())) {
+		auto as_double = [](const ConstValue &v) {
+			return v.isFloat() ? v.getFloat()
+							   : v.getInt().value.roundToDouble(true);
+		};
+		double a = as_double(l), b = as_double(r);
+
+		switch (op) {
+		case TokenType::PLUS:
+			value = ConstValue{a + b};
+			return;
+		case TokenType::MINUS:
+			value = ConstValue{a - b};
+			return;
+		case TokenType::STAR:
+			value = ConstValue{a * b};
+			return;
+		case TokenType::SLASH:
+			value = ConstValue{a / b};
+			return;
+		case TokenType::LESS:
+			value = ConstValue{a < b};
+			return;
+		case TokenType::LESS_EQUAL:
+			value = ConstValue{a <= b};
+			return;
+		case TokenType::GREATER:
+			value = ConstValue{a > b};
+			return;
+		case TokenType::GREATER_EQUAL:
+			value = ConstValue{a >= b};
+			return;
+		case TokenType::EQUAL_EQUAL:
+			value = ConstValue{a == b};
+			return;
+		case TokenType::BANG_EQUAL:
+			value = ConstValue{a != b};
+			return;
+		default:
+			break;
+		}
+	}
+
+	fail(it,
+		 fmt::format("operator {} cannot be applied to these values",
+					 it.Op.lexeme),
+		 "E0513");
+}
+
+void ConstEval::visit(CallExprAST &it) {
+	// a hint about branches has nothing to say about the value
+	using B = CallExprAST::Builtin;
+	if (it.builtin == B::Likely || it.builtin == B::Unlikely) {
+		value = eval(*it.Args[0]);
+		return;
+	}
+
+	auto proto = dynamic_cast<PrototypeAST *>(it.resolved_name);
+	FunctionAST *fn = proto ? functions[proto] : nullptr;
+
+	if (fn == nullptr) {
+		fail(it, fmt::format("{} cannot be called at compile time", it.Callee),
+			 "E0502");
+		return;
+	}
+
+	if (frames.size() >= limits.depth) {
+		fail(it,
+			 fmt::format("calls nested more than {} deep at compile time",
+						 limits.depth),
+			 "E0503");
+		return;
+	}
+
+	if (it.Args.size() != proto->parameters.size()) {
+		fail(it, fmt::format("{} takes {} arguments", proto->name,
+							 proto->parameters.size()),
+			 "E0515");
+		return;
+	}
+
+	std::vector<ConstValue> args;
+	std::string key = fmt::format("{}", (void *)fn);
+	for (size_t i = 0; i < it.Args.size(); i++) {
+		args.push_back(convert(eval(*it.Args[i]), *proto->parameters[i]->type,
+							   *it.Args[i]));
+		if (failed) return;
+		key += "," + args.back().key();
+	}
+
+	// nothing a function can do at compile time depends on anything but its
+	// arguments, so the same call always gives the same answer
+	if (auto found = memo.find(key); found != memo.end()) {
+		value = found->second;
+		return;
+	}
+
+	frames.push_back(Frame());
+	for (size_t i = 0; i < args.size(); i++)
+		bind(proto->parameters[i].get(), args[i]);
+
+	returning = false;
+	fn->body->accept(*this);
+
+	for (auto &[_, val] : frames.back())
+		memory -= val.footprint();
+	frames.pop_back();
+
+	if (failed) return;
+	if (!returning) {
+		fail(it, fmt::format("{} did not return a value", proto->name),
+			 "E0504");
+		return;
+	}
+
+	returning = false;
+	value = convert(ret_value, *proto->retType, it);
+	if (failed) return;
+
+	memory += key.size() + value.footprint();
+	memo[key] = value;
+	if (memory > limits.memory)
+		fail(it,
+			 fmt::format("constant evaluation used more than {} bytes",
+						 limits.memory),
+			 "E0505");
+}
+
+void ConstEval::visit(BlockAST &it) {
+	for (auto stmt : it.content) {
+		if (!step(*stmt)) return;
+		stmt->accept(*this);
+		if (returning || failed) return;
+	}
+}
+
+void ConstEval::visit(ExprStmt &it) { eval(*it.value); }
+
+ConstValue *ConstEval::place(ExprAST &target) {
+	// name resolution only lets `let mut` locals through, which all live in
+	// the current frame
+	if (auto variable = dynamic_cast<VariableExprAST *>(&target)) {
+		auto &frame = frames.back();
+		auto found = frame.find(variable->resolved_name);
+		if (found == frame.end() || found->second.empty()) {
+			fail(target,
+				 fmt::format("{} is used before it is given a value",
+							 variable->name),
+				 "E0507");
+			return nullptr;
+		}
+		return &found->second;
+	}
+
+	if (auto element = dynamic_cast<IndexExprAST *>(&target)) {
+		auto array = place(*element->array);
+		if (array == nullptr) return nullptr;
+		auto i = index(*element, *array);
+		return failed ? nullptr : &array->getAggregate().elements[i];
+	}
+
+	if (auto member = dynamic_cast<StructMemberAccessAST *>(&target)) {
+		auto parent = place(*member->parent);
+		if (parent == nullptr) return nullptr;
+		return &parent->getAggregate().elements[member->index];
+	}
+
+	fail(target, "references cannot be used at compile time", "E0517");
+	return nullptr;
+}
+
+void ConstEval::visit(AssignStmt &it) {
+	if (auto target = dynamic_cast<VariableExprAST *>(it.target.get())) {
+		auto decl = static_cast<VarDecl *>(target->resolved_name);
+		ConstValue v = convert(eval(*it.value), *decl->type, it);
+		if (!failed) bind(decl, v);
+		return;
+	}
+
+	// an element keeps its type, so the frame takes up as much as before
+	ConstValue v = convert(eval(*it.value), *it.target->checked_type, it);
+	if (failed) return;
+	if (auto slot = place(*it.target)) *slot = std::move(v);
+}
+
+void ConstEval::visit(ReturnStmt &it) {
+	ret_value = it.value ? eval(*it.value.value()) : ConstValue{};
+	returning = true;
+}
+
+void ConstEval::visit(IfStmt &it) {
+	ConstValue cond = eval(*it.condition);
+	if (failed) return;
+
+	if (!cond.isBool()) {
+		fail(*it.condition, "condition is not a bool", "E0508");
+		return;
+	}
+
+	if (cond.getBool())
+		it.block->accept(*this);
+	else if (it.else_)
+		it.else_.value()->accept(*this);
+}
+
+void ConstEval::visit(WhileStmt &it) {
+	while (step(it)) {
+		ConstValue cond = eval(*it.condition);
+		if (failed) return;
+
+		if (!cond.isBool()) {
+			fail(*it.condition, "condition is not a bool", "E0508");
+			return;
+		}
+		if (!cond.getBool()) return;
+
+		it.block->accept(*this);
+		if (returning || failed) return;
+	}
+}
+
+void ConstEval::visit(ForStmt &it) {
+	if (it.array) {
+		ConstValue array = eval(*it.array);
+		if (failed) return;
+		for (auto &element : array.getAggregate().elements) {
+			if (!step(it)) return;
+			bind(it.variable.get(), element);
+			it.block->accept(*this);
+			if (returning || failed) return;
+		}
+		return;
+	}
+
+	auto &type = *it.variable->type;
+	ConstValue start = convert(eval(*it.start), type, *it.start);
+	ConstValue end = convert(eval(*it.end), type, *it.end);
+	ConstValue by =
+		it.step ? convert(eval(*it.step.value()), type, *it.step.value())
+				: ConstValue{ConstValue::Int{llvm::APInt(type.bits(), 1),
+											 type.isSigned(), true}};
+	if (failed) return;
+
+	bool is_signed = type.isSigned();
+	auto s = by.getInt().value;
+	if (s.isZero() || (is_signed && s.isNegative())) {
+		fail(*it.step.value(), "the step of a range has to be positive",
+			 "E0516");
+		return;
+	}
+
+	auto i = start.getInt().value, e = end.getInt().value;
+	while (step(it)) {
+		if (is_signed ? i.sge(e) : i.uge(e)) return;
+
+		bind(it.variable.get(),
+			 ConstValue{ConstValue::Int{i, is_signed, true}});
+		it.block->accept(*this);
+		if (returning || failed) return;
+
+		// the end of the range is never past the largest value, so wrapping
+		// around means the range is done
+		bool overflow;
+		i = is_signed ? i.sadd_ov(s, overflow) : i.uadd_ov(s, overflow);
+		if (overflow) return;
+	}
+}
+
+void ConstEval::visit(VarDecl &it) {
+	if (it.constant) {
+		evaluate(it);
+		if (it.folded) bind(&it, it.folded.value());
+		return;
+	}
+
+	ConstValue v;
+	if (it.value) v = convert(eval(*it.value.value()), *it.type, it);
+	if (!failed) bind(&it, v);
+}
+
+// nothing to run for declarations themselves
+void ConstEval::visit(ParameterAST &) {}
+void ConstEval::visit(FunctionAST &) {}
+void ConstEval::visit(PrototypeAST &) {}
+void ConstEval::visit(TypeAST &) {}
+void ConstEval::visit(StructMemberAST &) {}
+void ConstEval::visit(StructAST &) {}
+} // namespace FoxLang
@@ -0,0 +1,92 @@
+#pragma once
+
+#include "ast_nodes.hpp"
+#include "ast_pass.hpp"
+#include "diagnostics.hpp"
+
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace FoxLang {
+/// ConstEval - Computes the value of every `const` declaration by
+/// interpreting the resolved AST. Initializers may call any function whose
+/// body can be run without references, building arrays and structs along
+/// the way, and the result of each call is memoized so tables built from
+/// the same helper are only computed once.
+/// Runs after name resolution and fills in VarDecl::folded.
+class ConstEval : public ASTVisitor {
+public:
+	struct Limits {
+		// statements and expressions evaluated for a single const
+		uint64_t steps = 10'000'000;
+		// bytes held in live frames and the memo table
+		size_t memory = 64 * 1024 * 1024;
+		unsigned depth = 512;
+	};
+
+	ConstEval(Diagnostics &diagnostics, Limits limits)
+		: diagnostics(diagnostics), limits(limits) {}
+
+	virtual void visit(BlockAST &it);
+	virtual void visit(BinaryExprAST &it);
+	virtual void visit(CallExprAST &it);
+	virtual void visit(NumberExprAST &it);
+	virtual void visit(StringLiteralAST &it);
+	virtual void visit(BoolLiteralAST &it);
+	virtual void visit(StructLiteralAST &it);
+	virtual void visit(ArrayLiteralAST &it);
+	virtual void visit(VariableExprAST &it);
+	virtual void visit(IndexExprAST &it);
+	virtual void visit(RefExprAST &it);
+	virtual void visit(DerefExprAST &it);
+	virtual void visit(StructMemberAccessAST &it);
+	virtual void visit(LayoutExprAST &it);
+	virtual void visit(FileAST &it);
+	virtual void visit(ParameterAST &it);
+	virtual void visit(FunctionAST &it);
+	virtual void visit(PrototypeAST &it);
+	virtual void visit(ExprStmt &it);
+	virtual void visit(AssignStmt &it);
+	virtual void visit(ReturnStmt &it);
+	virtual void visit(IfStmt &it);
+	virtual void visit(WhileStmt &it);
+	virtual void visit(ForStmt &it);
+	virtual void visit(VarDecl &it);
+	virtual void visit(TypeAST &it);
+	virtual void visit(StructMemberAST &it);
+	virtual void visit(StructAST &it);
+
+private:
+	typedef std::map<AST *, ConstValue> Frame;
+
+	Diagnostics &diagnostics;
+	Limits limits;
+
+	std::map<PrototypeAST *, FunctionAST *> functions;
+	std::map<std::string, ConstValue> memo;
+	std::vector<Frame> frames;
+	std::set<VarDecl *> in_progress;
+
+	uint64_t steps = 0;
+	size_t memory = 0;
+
+	// result of the last expression, and of the last return statement
+	ConstValue value;
+	ConstValue ret_value;
+	bool returning = false;
+	bool failed = false;
+
+	void evaluate(VarDecl &decl);
+	ConstValue eval(ExprAST &expr);
+	ConstValue convert(const ConstValue &v, TypeAST &type, AST &node);
+	/// The element `it` picks out of `array`, checked against its length
+	size_t index(IndexExprAST &it, const ConstValue &array);
+	/// The value in the current frame an assignment to `target` changes
+	ConstValue *place(ExprAST &target);
+	void bind(AST *decl, ConstValue value);
+	bool step(AST &node);
+	void fail(AST &node, std::string message, std::string code);
+};
+} // namespace FoxLang
@@ -0,0 +1,35 @@
+#include "const_value.hpp"
+
+#include <bit>
+#include <fmt/format.h>
+#include <llvm/ADT/StringExtras.h>
+
+namespace FoxLang {
+std::string ConstValue::key() const {
+	if (isInt()) {
+		auto &i = getInt();
+		return fmt::format("{}{}:{}", i.is_signed ? 'i' : 'u',
+						   i.value.getBitWidth(),
+						   llvm::toString(i.value, 16, false));
+	}
+	// compare floats by their bits so -0.0 and nan memoize correctly
+	if (isFloat())
+		return fmt::format("f:{:x}", std::bit_cast<uint64_t>(getFloat()));
+	if (isBool()) return getBool() ? "b:1" : "b:0";
+	if (isAggregate()) {
+		std::string key = "[";
+		for (auto &element : getAggregate().elements)
+			key += element.key() + ",";
+		return key + "]";
+	}
+	return "_";
+}
+
+size_t ConstValue::footprint() const {
+	size_t bytes = sizeof(ConstValue);
+	if (isAggregate())
+		for (auto &element : getAggregate().elements)
+			bytes += element.footprint();
+	return bytes;
+}
+} // namespace FoxLang
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <llvm/ADT/APInt.h>
+
+#include <string>
+#include <variant>
+#include <vector>
+
+namespace FoxLang {
+/// ConstValue - A value computed by the compile-time evaluator. Integers keep
+/// the width and signedness of the type they were computed in, unsized
+/// literals stay 64 bits wide until they are stored somewhere with a type.
+/// Arrays, vectors and structs are aggregates of the values they hold.
+struct ConstValue {
+	struct Int {
+		llvm::APInt value;
+		bool is_signed;
+		bool sized;
+	};
+
+	struct Aggregate {
+		// the elements of an array or vector, or the members of a struct in
+		// the order StructAST declares them
+		std::vector<ConstValue> elements;
+	};
+
+	std::variant<std::monostate, Int, double, bool, Aggregate> data;
+
+	bool isInt() const { return std::holds_alternative<Int>(data); }
+	bool isFloat() const { return std::holds_alternative<double>(data); }
+	bool isBool() const { return std::holds_alternative<bool>(data); }
+	bool isAggregate() const { return std::holds_alternative<Aggregate>(data); }
+	bool empty() const { return std::holds_alternative<std::monostate>(data); }
+
+	const Int &getInt() const { return std::get<Int>(data); }
+	double getFloat() const { return std::get<double>(data); }
+	bool getBool() const { return std::get<bool>(data); }
+	const Aggregate &getAggregate() const { return std::get<Aggregate>(data); }
+	Aggregate &getAggregate() { return std::get<Aggregate>(data); }
+
+	/// Bytes the value occupies, counted against the evaluator memory limit
+	size_t footprint() const;
+
+	/// A string that is equal for two values exactly when they are, used to
+	/// memoize calls
+	std::string key() const;
+};
+} // namespace FoxLang
@@ -0,0 +1,71 @@
+#include "diagnostics.hpp"
+
+#include <algorithm>
+#include <tuple>
+
+namespace FoxLang {
+static std::atomic<uint64_t> next_id = 1;
+
+Diagnostics::Diagnostics(unsigned error_limit)
+	: id(next_id.fetch_add(1, std::memory_order_relaxed)),
+	  error_limit(error_limit) {}
+
+Diagnostics::Buffer &Diagnostics::local() {
+	// cache the buffer of the engine this thread used last, the id guards
+	// against a new engine being constructed at the address of an old one
+	thread_local struct {
+		uint64_t owner = 0;
+		Buffer *buffer = nullptr;
+	} cache;
+
+	if (cache.owner == id) return *cache.buffer;
+
+	std::lock_guard guard(buffers_lock);
+	auto self = std::this_thread::get_id();
+	auto found = std::find_if(buffers.begin(), buffers.end(),
+							  [&](auto &b) { return b->owner == self; });
+
+	if (found == buffers.end()) {
+		buffers.push_back(std::make_unique<Buffer>());
+		buffers.back()->owner = self;
+		found = buffers.end() - 1;
+	}
+
+	cache.owner = id;
+	cache.buffer = found->get();
+	return *cache.buffer;
+}
+
+void Diagnostics::report(Message message) {
+	if (message.level == Severity::Error)
+		errors.fetch_add(1, std::memory_order_relaxed);
+
+	Buffer &buffer = local();
+	std::lock_guard guard(buffer.lock);
+	buffer.messages.push_back(std::move(message));
+}
+
+std::vector<Message> Diagnostics::drain() {
+	std::vector<Message> out;
+
+	{
+		std::lock_guard guard(buffers_lock);
+		for (auto &buffer : buffers) {
+			std::lock_guard inner(buffer->lock);
+			std::move(buffer->messages.begin(), buffer->messages.end(),
+					  std::back_inserter(out));
+			buffer->messages.clear();
+		}
+	}
+
+	// order on everything, not only the location, so two messages at the same
+	// spot still come out the same way regardless of which thread won
+	std::sort(out.begin(), out.end(), [](const Message &a, const Message &b) {
+		return std::tie(a.span.loc, a.level, a.code, a.message,
+						a.span.length) < std::tie(b.span.loc, b.level, b.code,
+												  b.message, b.span.length);
+	});
+
+	return out;
+}
+} // namespace FoxLang
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "message.hpp"
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace FoxLang {
+/// Diagnostics - Collects the messages every compiler phase reports. Each
+/// thread appends to a buffer of its own, so reporting never contends on a
+/// shared lock, and drain() merges the buffers sorted by source location so
+/// the output is the same no matter how the work was split between threads.
+class Diagnostics {
+public:
+	/// error_limit of 0 means never abort early
+	explicit Diagnostics(unsigned error_limit = 0);
+
+	void report(Message message);
+
+	/// True once error_limit errors have been reported. Phases poll this to
+	/// stop doing work nobody is going to look at.
+	bool shouldAbort() const {
+		return error_limit != 0 && errors.load(std::memory_order_relaxed) >=
+									   error_limit;
+	}
+
+	bool hasErrors() const {
+		return errors.load(std::memory_order_relaxed) != 0;
+	}
+	unsigned errorCount() const {
+		return errors.load(std::memory_order_relaxed);
+	}
+
+	/// Removes every message reported so far and returns them ordered by
+	/// location. Safe to call while other threads are still reporting, which
+	/// lets main stream messages out between phases.
+	std::vector<Message> drain();
+
+private:
+	struct Buffer {
+		std::thread::id owner;
+		std::mutex lock; // only contended while drain() is running
+		std::vector<Message> messages;
+	};
+
+	Buffer &local();
+
+	const uint64_t id;
+	const unsigned error_limit;
+	std::atomic<unsigned> errors = 0;
+
+	std::mutex buffers_lock; // taken once per thread, when it first reports
+	std::vector<std::unique_ptr<Buffer>> buffers;
+};
+} // namespace FoxLang
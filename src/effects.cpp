@@ -0,0 +1,278 @@
+#include "effects.hpp"
+
+namespace FoxLang {
+// every node below `node`, statements and expressions alike, parents first
+static void collect(AST *node, std::vector<AST *> &out) {
+	for (auto child : node->getChildren()) {
+		if (child == nullptr) continue;
+		out.push_back(child);
+		collect(child, out);
+	}
+}
+
+static bool pointers(const TypeAST &type) {
+	if (type.type == TypeAST::Type::pointer) return true;
+	if (type.type == TypeAST::Type::_struct && type.resolved_name != nullptr) {
+		for (auto &member : type.resolved_name->members)
+			if (pointers(*member->value)) return true;
+		return false;
+	}
+	return type.child && pointers(*type.child.value());
+}
+
+static bool pointers(const ExprAST &expr) {
+	return expr.checked_type != nullptr && pointers(*expr.checked_type);
+}
+
+static bool reference(const ExprAST &expr) {
+	return expr.checked_type != nullptr &&
+		   expr.checked_type->type == TypeAST::Type::pointer;
+}
+
+// a reference parameter, memory the caller can see
+static ParameterAST *parameter(AST *root) {
+	auto param = dynamic_cast<ParameterAST *>(root);
+	if (param == nullptr || param->type->type != TypeAST::Type::pointer)
+		return nullptr;
+	return param;
+}
+
+// whether `root` from RefExprAST::borrowed may be outside the function
+static bool outside(AST *root) {
+	return root == nullptr || parameter(root) != nullptr;
+}
+
+// sets `flag` on the parameter `root` is, or on every reference parameter of
+// `proto` when it is not known. Locals are nobody else's business
+static void mark(PrototypeAST &proto, AST *root, bool ParameterAST::*flag) {
+	if (auto param = parameter(root)) {
+		param->*flag = true;
+		return;
+	}
+	if (root != nullptr) return;
+	for (auto &param : proto.parameters)
+		if (param->type->type == TypeAST::Type::pointer) (*param).*flag = true;
+}
+
+DerefExprAST *Effects::through(ExprAST &place) {
+	auto deref = dynamic_cast<DerefExprAST *>(IndexExprAST::base(place));
+	if (deref != nullptr) places.insert(deref);
+	return deref;
+}
+
+void Effects::written(ExprAST &pointer) {
+	auto root = RefExprAST::borrowed(pointer);
+	if (outside(root)) current->writes = true;
+	mark(*current, root, &ParameterAST::written);
+}
+
+void Effects::captured(ExprAST &value) {
+	if (!pointers(value)) return;
+	// a reference inside an array or struct cannot be followed, and could
+	// be written through once it has been loaded back out
+	if (!reference(value)) {
+		mark(*current, nullptr, &ParameterAST::captured);
+		mark(*current, nullptr, &ParameterAST::written);
+		return;
+	}
+	mark(*current, RefExprAST::borrowed(value), &ParameterAST::captured);
+}
+
+void Effects::visit(FileAST &it) {
+	std::vector<FunctionAST *> functions;
+	for (auto i : it.expressions)
+		if (auto f = dynamic_cast<FunctionAST *>(i.get())) {
+			functions.push_back(f);
+			auto &proto = *f->proto;
+			proto.reads = proto.writes = proto.traps = false;
+			for (auto &param : proto.parameters)
+				param->written = param->captured = false;
+		}
+
+	for (auto f : functions)
+		f->accept(*this);
+
+	// what a callee does its callers do as well, and a callee writing or
+	// keeping a reference does so to whatever the caller passed for it
+	bool changed = true;
+	while (changed) {
+		changed = false;
+		for (auto &call : calls) {
+			auto &caller = *call.caller, &callee = *call.callee;
+			bool before[] = {caller.reads, caller.writes, caller.traps};
+			caller.reads |= callee.reads;
+			caller.writes |= callee.writes;
+			caller.traps |= callee.traps;
+			changed |= before[0] != caller.reads ||
+					   before[1] != caller.writes || before[2] != caller.traps;
+
+			for (size_t i = 0; i < call.roots.size(); i++) {
+				auto &param = *callee.parameters[i];
+				if (param.type->type != TypeAST::Type::pointer) continue;
+				for (auto flag :
+					 {&ParameterAST::written, &ParameterAST::captured}) {
+					if (!(param.*flag)) continue;
+					std::vector<bool> was;
+					for (auto &p : caller.parameters)
+						was.push_back((*p).*flag);
+					mark(caller, call.roots[i], flag);
+					for (size_t j = 0; j < was.size(); j++)
+						changed |= was[j] != (*caller.parameters[j]).*flag;
+				}
+			}
+		}
+	}
+
+	// a function returns unless it loops or calls one that may not, which
+	// only settles from above since recursion never returns by itself
+	for (auto f : functions)
+		f->proto->diverges = true;
+	changed = true;
+	while (changed) {
+		changed = false;
+		for (auto f : functions) {
+			auto proto = f->proto.get();
+			bool diverges = loops.contains(proto);
+			for (auto &call : calls)
+				if (call.caller == proto) diverges |= call.callee->diverges;
+			changed |= diverges != proto->diverges;
+			proto->diverges = diverges;
+		}
+	}
+}
+
+void Effects::visit(FunctionAST &it) {
+	current = it.proto.get();
+	places.clear();
+
+	std::vector<AST *> nodes;
+	collect(it.body.get(), nodes);
+	for (auto node : nodes)
+		node->accept(*this);
+}
+
+void Effects::visit(DerefExprAST &it) {
+	if (places.contains(&it)) return;
+	if (outside(RefExprAST::borrowed(*it.pointer))) current->reads = true;
+}
+
+void Effects::visit(RefExprAST &it) {
+	// borrowing is not reading, what is done with the reference counts
+	through(*it.target);
+}
+
+void Effects::visit(AssignStmt &it) {
+	if (auto deref = through(*it.target)) {
+		written(*deref->pointer);
+		captured(*it.value);
+	} else if (pointers(*it.value)) {
+		// kept in a local array, from where it cannot be followed
+		captured(*it.value);
+		mark(*current, RefExprAST::borrowed(*it.value), &ParameterAST::written);
+	}
+}
+
+void Effects::visit(ReturnStmt &it) {
+	if (it.value) captured(*it.value.value());
+}
+
+void Effects::visit(CallExprAST &it) {
+	using B = CallExprAST::Builtin;
+	switch (it.builtin) {
+	case B::Load:
+	case B::MaskedLoad:
+		// these check the whole range they read is in bounds
+		current->traps = true;
+		return;
+	case B::Store:
+	case B::MaskedStore:
+		current->traps = true;
+		if (auto deref = through(*it.Args[0])) written(*deref->pointer);
+		return;
+	default:
+		break;
+	}
+
+	auto callee = dynamic_cast<PrototypeAST *>(it.resolved_name);
+	if (callee == nullptr) return;
+
+	Call call{current, callee, {}};
+	for (auto &arg : it.Args) {
+		if (!reference(*arg)) {
+			captured(*arg);
+			call.roots.push_back(nullptr);
+			continue;
+		}
+		call.roots.push_back(RefExprAST::borrowed(*arg));
+	}
+	calls.push_back(std::move(call));
+}
+
+void Effects::visit(StructLiteralAST &it) {
+	for (auto &value : it.values) {
+		captured(*value);
+		if (reference(*value))
+			mark(*current, RefExprAST::borrowed(*value),
+				 &ParameterAST::written);
+	}
+}
+
+void Effects::visit(ArrayLiteralAST &it) {
+	for (auto &element : it.elements) {
+		captured(*element);
+		if (reference(*element))
+			mark(*current, RefExprAST::borrowed(*element),
+				 &ParameterAST::written);
+	}
+}
+
+void Effects::visit(IndexExprAST &it) {
+	if (it.checked) current->traps = true;
+}
+
+void Effects::visit(BinaryExprAST &it) {
+	if (it.LHS->checked_type == nullptr ||
+		!it.LHS->checked_type->scalar().isInteger())
+		return;
+
+	switch (it.Op.type) {
+	case TokenType::PLUS:
+	case TokenType::MINUS:
+	case TokenType::STAR:
+	case TokenType::LEFT_SHIFT:
+	case TokenType::RIGHT_SHIFT:
+		if (trapping) current->traps = true;
+		break;
+	case TokenType::SLASH:
+	case TokenType::PERCENT:
+		if (dividing) current->traps = true;
+		break;
+	default:
+		break;
+	}
+}
+
+void Effects::visit(WhileStmt &) { loops.insert(current); }
+
+void Effects::visit(ForStmt &it) {
+	// a step that is not known to be positive is checked when the loop starts
+	if (it.step && !dynamic_cast<NumberExprAST *>(it.step.value().get()))
+		current->traps = true;
+}
+
+void Effects::visit(BlockAST &) {}
+void Effects::visit(NumberExprAST &) {}
+void Effects::visit(StringLiteralAST &) {}
+void Effects::visit(BoolLiteralAST &) {}
+void Effects::visit(VariableExprAST &) {}
+void Effects::visit(StructMemberAccessAST &) {}
+void Effects::visit(LayoutExprAST &) {}
+void Effects::visit(ParameterAST &) {}
+void Effects::visit(PrototypeAST &) {}
+void Effects::visit(ExprStmt &) {}
+void Effects::visit(IfStmt &) {}
+void Effects::visit(VarDecl &) {}
+void Effects::visit(TypeAST &) {}
+void Effects::visit(StructMemberAST &) {}
+void Effects::visit(StructAST &) {}
+} // namespace FoxLang
@@ -0,0 +1,82 @@
+#pragma once
+
+#include "ast_nodes.hpp"
+#include "ast_pass.hpp"
+
+#include <map>
+#include <set>
+#include <vector>
+
+namespace FoxLang {
+/// Effects - Works out what calling each function can do besides computing
+/// its result, and narrows the flags on PrototypeAST and ParameterAST that
+/// start out assuming the worst. There is no global state, so what reference
+/// parameters point to is the only memory a function reaches outside its own
+/// frame, and a reference can only outlive the call by being returned or
+/// written through another one. What a function calls counts as what it
+/// does, which is settled once for the whole file, recursion included. Runs
+/// after BoundsCheck, whose checks it counts.
+class Effects : public ASTVisitor {
+public:
+	/// `trapping` is whether integer overflow stops the program, arithmetic
+	/// can then fail on its own. `dividing` is whether a division checks its
+	/// divisor, which it does under every policy that defines overflow
+	Effects(bool trapping, bool dividing)
+		: trapping(trapping), dividing(dividing) {}
+
+	virtual void visit(BlockAST &it);
+	virtual void visit(BinaryExprAST &it);
+	virtual void visit(CallExprAST &it);
+	virtual void visit(NumberExprAST &it);
+	virtual void visit(StringLiteralAST &it);
+	virtual void visit(BoolLiteralAST &it);
+	virtual void visit(StructLiteralAST &it);
+	virtual void visit(ArrayLiteralAST &it);
+	virtual void visit(VariableExprAST &it);
+	virtual void visit(IndexExprAST &it);
+	virtual void visit(RefExprAST &it);
+	virtual void visit(DerefExprAST &it);
+	virtual void visit(StructMemberAccessAST &it);
+	virtual void visit(LayoutExprAST &it);
+	virtual void visit(FileAST &it);
+	virtual void visit(ParameterAST &it);
+	virtual void visit(FunctionAST &it);
+	virtual void visit(PrototypeAST &it);
+	virtual void visit(ExprStmt &it);
+	virtual void visit(AssignStmt &it);
+	virtual void visit(ReturnStmt &it);
+	virtual void visit(IfStmt &it);
+	virtual void visit(WhileStmt &it);
+	virtual void visit(ForStmt &it);
+	virtual void visit(VarDecl &it);
+	virtual void visit(TypeAST &it);
+	virtual void visit(StructMemberAST &it);
+	virtual void visit(StructAST &it);
+
+private:
+	bool trapping, dividing;
+
+	struct Call {
+		PrototypeAST *caller, *callee;
+		// where each reference argument points into, nullptr when that
+		// cannot be told or the argument is no reference
+		std::vector<AST *> roots;
+	};
+	std::vector<Call> calls;
+	// functions with a `while`, which may run forever
+	std::set<PrototypeAST *> loops;
+
+	// the function being looked at, and what it does by itself
+	PrototypeAST *current = nullptr;
+	// dereferences that name a place to write to or borrow, not a read
+	std::set<DerefExprAST *> places;
+
+	/// Marks the dereference `place` goes through, if any, as not a read and
+	/// returns it
+	DerefExprAST *through(ExprAST &place);
+	/// Records a write through `pointer`
+	void written(ExprAST &pointer);
+	/// Records that the references in `value` may outlive the call
+	void captured(ExprAST &value);
+};
+} // namespace FoxLang
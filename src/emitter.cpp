@@ -0,0 +1,182 @@
+#include "emitter.hpp"
+
+#include <fmt/format.h>
+#include <llvm/Bitcode/BitcodeReader.h>
+#include <llvm/Bitcode/BitcodeWriter.h>
+#include <llvm/IR/LegacyPassManager.h>
+#include <llvm/Linker/Linker.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/Program.h>
+#include <llvm/Support/raw_ostream.h>
+#include <llvm/TargetParser/Host.h>
+#include <llvm/TargetParser/Triple.h>
+
+namespace FoxLang {
+std::string Emitter::extension(Kind kind) {
+	switch (kind) {
+	case Kind::Object:
+		return "o";
+	case Kind::Assembly:
+		return "s";
+	case Kind::Bitcode:
+		return "bc";
+	case Kind::LLVMIR:
+		return "ll";
+	}
+	return "";
+}
+
+bool Emitter::combines(const Target &target) {
+	// a linker for another architecture or object format cannot read them
+	llvm::Triple triple(target.getTriple());
+	llvm::Triple host(llvm::sys::getProcessTriple());
+	if (triple.getArch() != host.getArch() ||
+		triple.getObjectFormat() != host.getObjectFormat())
+		return false;
+	return static_cast<bool>(llvm::sys::findProgramByName("ld"));
+}
+
+std::optional<std::string>
+Emitter::write(std::vector<Partition> &partitions, const std::string &path) {
+	// partitions come without objects when ld could not combine them
+	if (kind == Kind::Object && !partitions.front().object.empty())
+		return writeObject(partitions, path);
+
+	// partitions live in contexts of their own, so they go through bitcode
+	// to end up in the same one before linking
+	llvm::LLVMContext context;
+	auto &source = partitions.front().ir->llvm_module->getSourceFileName();
+	auto merged = std::make_unique<llvm::Module>(source, context);
+	merged->setSourceFileName(source);
+	llvm::Linker linker(*merged);
+
+	for (auto &partition : partitions) {
+		llvm::SmallVector<char, 0> buffer;
+		llvm::raw_svector_ostream os(buffer);
+		llvm::WriteBitcodeToFile(*partition.ir->llvm_module, os);
+
+		auto module = llvm::parseBitcodeFile(
+			llvm::MemoryBufferRef(llvm::StringRef(buffer.data(), buffer.size()),
+								  partition.ir->llvm_module->getName()),
+			context);
+		if (!module) return llvm::toString(module.takeError());
+
+		if (linker.linkInModule(std::move(*module)))
+			return fmt::format("could not link partition `{}`",
+							   partition.ir->llvm_module->getName().str());
+	}
+
+	std::error_code ec;
+	llvm::raw_fd_ostream os(path, ec, llvm::sys::fs::OF_None);
+	if (ec) return ec.message();
+
+	switch (kind) {
+	case Kind::Bitcode:
+		llvm::WriteBitcodeToFile(*merged, os);
+		break;
+	case Kind::LLVMIR:
+		merged->print(os, nullptr);
+		break;
+	case Kind::Assembly: {
+		auto machine = target.createMachine(level);
+		llvm::legacy::PassManager pm;
+		if (machine->addPassesToEmitFile(pm, os, nullptr,
+										 llvm::CodeGenFileType::AssemblyFile))
+			return "the target cannot emit assembly";
+		pm.run(*merged);
+		break;
+	}
+	case Kind::Object: {
+		auto machine = target.createMachine(level);
+		llvm::legacy::PassManager pm;
+		if (machine->addPassesToEmitFile(pm, os, nullptr,
+										 llvm::CodeGenFileType::ObjectFile))
+			return "the target cannot emit objects";
+		pm.run(*merged);
+		break;
+	}
+	}
+
+	os.close();
+	if (os.has_error()) return os.error().message();
+	return std::nullopt;
+}
+
+std::optional<std::string>
+Emitter::writeObject(std::vector<Partition> &partitions,
+					 const std::string &path) {
+	if (partitions.size() == 1) {
+		std::error_code ec;
+		llvm::raw_fd_ostream os(path, ec, llvm::sys::fs::OF_None);
+		if (ec) return ec.message();
+
+		auto &object = partitions.front().object;
+		os.write(object.data(), object.size());
+		os.close();
+		if (os.has_error()) return os.error().message();
+		return std::nullopt;
+	}
+
+	// several objects are combined into one with a relocatable link, so the
+	// output can be used the same way no matter how many units there were
+	auto ld = llvm::sys::findProgramByName("ld");
+	if (!ld)
+		return "`ld` is needed to combine codegen units, use "
+			   "--codegen-units=1 to emit a single object without it";
+
+	std::vector<std::string> inputs;
+	auto cleanup = [&] {
+		for (auto &input : inputs)
+			llvm::sys::fs::remove(input);
+	};
+
+	for (auto &partition : partitions) {
+		int fd;
+		llvm::SmallString<128> input;
+		if (auto ec =
+				llvm::sys::fs::createTemporaryFile("fox", "o", fd, input)) {
+			cleanup();
+			return ec.message();
+		}
+		inputs.push_back(input.str().str());
+
+		llvm::raw_fd_ostream os(fd, true);
+		os.write(partition.object.data(), partition.object.size());
+		os.close();
+		if (os.has_error()) {
+			cleanup();
+			return os.error().message();
+		}
+	}
+
+	// ld cannot write to stdout, so go through a file for "-" as well
+	std::string output = path;
+	if (path == "-") {
+		llvm::SmallString<128> tmp;
+		llvm::sys::fs::createTemporaryFile("fox", "o", tmp);
+		output = tmp.str().str();
+		inputs.push_back(output);
+	}
+
+	std::vector<llvm::StringRef> args = {*ld, "-r", "-o", output};
+	for (size_t i = 0; i < partitions.size(); i++)
+		args.push_back(inputs[i]);
+
+	std::string message;
+	int status = llvm::sys::ExecuteAndWait(*ld, args, std::nullopt, {}, 0, 0,
+										   &message);
+	if (status != 0) {
+		cleanup();
+		return fmt::format("`ld -r` failed{}{}", message.empty() ? "" : ": ",
+						   message);
+	}
+
+	if (path == "-") {
+		auto buffer = llvm::MemoryBuffer::getFile(output);
+		if (buffer) llvm::outs() << (*buffer)->getBuffer();
+	}
+
+	cleanup();
+	return std::nullopt;
+}
+} // namespace FoxLang
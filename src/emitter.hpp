@@ -0,0 +1,44 @@
+#pragma once
+
+#include "codegen.hpp"
+#include "target.hpp"
+
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace FoxLang {
+/// Emitter - Writes the partitions of a program to a single output file.
+/// Objects are compiled per partition on the worker threads and combined
+/// with a relocatable link, everything else is emitted from the partitions
+/// linked back into one module. So are objects the host's `ld` cannot
+/// combine.
+class Emitter {
+public:
+	enum class Kind { Object, Assembly, Bitcode, LLVMIR };
+
+	Emitter(Kind kind, const Target &target, Optimizer::Level level)
+		: kind(kind), target(target), level(level) {}
+
+	/// The file extension used for outputs of `kind`
+	static std::string extension(Kind kind);
+
+	/// Whether objects for `target` can be combined with the host's `ld -r`.
+	/// When they cannot, partitions should not be compiled to objects and
+	/// are emitted as one module instead
+	static bool combines(const Target &target);
+
+	/// Writes the output to `path`, "-" for stdout. Returns why it could not
+	/// be written, if it could not
+	std::optional<std::string> write(std::vector<Partition> &partitions,
+									 const std::string &path);
+
+private:
+	Kind kind;
+	const Target &target;
+	Optimizer::Level level;
+
+	std::optional<std::string> writeObject(std::vector<Partition> &partitions,
+										   const std::string &path);
+};
+} // namespace FoxLang
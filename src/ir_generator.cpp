@@ -1,18 +1,78 @@
 #include "ir_generator.hpp"
 #include "ast_nodes.hpp"
 #include <fmt/base.h>
+#include <fmt/format.h>
 #include <llvm/IR/Constants.h>
 #include <llvm/IR/DerivedTypes.h>
+#include <llvm/IR/GlobalIFunc.h>
+#include <llvm/IR/Intrinsics.h>
+#include <llvm/IR/MDBuilder.h>
 #include <llvm/IR/Verifier.h>
+#include <llvm/Support/raw_ostream.h>
+#include <llvm/TargetParser/Triple.h>
+#include <numeric>
 #include <variant>
 
 namespace FoxLang::IR {
-std::unique_ptr<llvm::LLVMContext> Generator::context =
-	std::make_unique<llvm::LLVMContext>();
-std::unique_ptr<llvm::IRBuilder<>> Generator::builder =
-	std::make_unique<llvm::IRBuilder<>>(*Generator::context);
-std::unique_ptr<llvm::Module> Generator::llvm_module =
-	std::make_unique<llvm::Module>("FoxLang", *Generator::context);
+Generator::Generator(const std::string &name,
+					 std::set<const FunctionAST *> owned, bool primary)
+	: context(std::make_unique<llvm::LLVMContext>()),
+	  builder(std::make_unique<llvm::IRBuilder<>>(*context)),
+	  llvm_module(std::make_unique<llvm::Module>(name, *context)),
+	  owned(std::move(owned)), primary(primary) {}
+
+void Generator::error(AST &node, std::string message, std::string code) {
+	broken = true;
+	if (diagnostics == nullptr) return;
+	diagnostics->report(
+		Message{.message = std::move(message),
+				.level = Severity::Error,
+				.code = std::move(code),
+				.span = Location{.loc = node.loc, .length = 1}});
+}
+
+std::optional<Generator::FPMode>
+Generator::parseFPMode(std::string_view name) {
+	if (name == "strict") return FPMode::Strict;
+	if (name == "contract") return FPMode::Contract;
+	if (name == "fast") return FPMode::Fast;
+	return std::nullopt;
+}
+
+llvm::FastMathFlags Generator::fastMath(const PrototypeAST &proto) {
+	auto mode = fp_mode;
+	// TypeCheck already rejected a malformed attribute
+	if (auto a = proto.attribute("fp_mode"); a && a->args.size() == 1)
+		mode = parseFPMode(a->args[0].value).value_or(mode);
+
+	// the flags go on each instruction rather than the function, so they
+	// still hold once a strict function is inlined into a fast one
+	llvm::FastMathFlags flags;
+	if (mode == FPMode::Fast)
+		flags.setFast();
+	else if (mode == FPMode::Contract)
+		flags.setAllowContract();
+	return flags;
+}
+
+void Generator::fallthrough(llvm::BasicBlock *from, llvm::BasicBlock *to) {
+	// a block that already ended in a return must not get a second terminator
+	if (from->getTerminator() == nullptr) {
+		builder->SetInsertPoint(from);
+		builder->CreateBr(to);
+	}
+}
+
+llvm::AllocaInst *Generator::entryAlloca(llvm::Type *type,
+										 const std::string &name) {
+	// allocas outside the entry block are dynamic, they grow the stack on
+	// every loop iteration and mem2reg will not touch them
+	auto &entry = builder->GetInsertBlock()->getParent()->getEntryBlock();
+	llvm::IRBuilder<> tmp(&entry, entry.getFirstInsertionPt());
+	auto alloca = tmp.CreateAlloca(type, nullptr, name);
+	alloca->setAlignment(std::max(alloca->getAlign(), alignment(type)));
+	return alloca;
+}
 
 void Generator::visit(BlockAST &it) {
 	for (auto stmt : it.content) {
@@ -23,99 +83,702 @@ void Generator::visit(BlockAST &it) {
 	return;
 }
 
+void Generator::trapIf(llvm::Value *condition) {
+	// a vector traps when any of its lanes would
+	if (condition->getType()->isVectorTy())
+		condition = builder->CreateOrReduce(condition);
+
+	auto function = builder->GetInsertBlock()->getParent();
+	auto trap = llvm::BasicBlock::Create(*context, "trap", function);
+	auto next = llvm::BasicBlock::Create(*context, "checked", function);
+
+	auto weights = llvm::MDBuilder(*context).createBranchWeights(1, 1 << 20);
+	builder->CreateCondBr(condition, trap, next, weights);
+
+	builder->SetInsertPoint(trap);
+	builder->CreateIntrinsic(llvm::Intrinsic::trap, {}, {});
+	builder->CreateUnreachable();
+
+	builder->SetInsertPoint(next);
+}
+
+llvm::Value *Generator::arithmetic(llvm::Instruction::BinaryOps op,
+								   llvm::Intrinsic::ID checked,
+								   llvm::Value *left, llvm::Value *right,
+								   bool is_signed) {
+	switch (overflow) {
+	case Overflow::Wrap:
+		return builder->CreateBinOp(op, left, right);
+	case Overflow::Undefined: {
+		// overflow never happens in a correct program, which is what lets
+		// llvm reason about induction variables and widen them
+		auto result = builder->CreateBinOp(op, left, right);
+		// constant operands fold to a constant, which has no flags to set
+		if (auto inst = llvm::dyn_cast<llvm::BinaryOperator>(result)) {
+			if (is_signed)
+				inst->setHasNoSignedWrap();
+			else
+				inst->setHasNoUnsignedWrap();
+		}
+		return result;
+	}
+	case Overflow::Trap: {
+		auto result = builder->CreateBinaryIntrinsic(checked, left, right);
+		trapIf(builder->CreateExtractValue(result, 1));
+		return builder->CreateExtractValue(result, 0);
+	}
+	}
+	return nullptr;
+}
+
+void Generator::logical(BinaryExprAST &it) {
+	bool is_and = it.Op.type == TokenType::AND;
+	it.LHS->accept(*this);
+	auto left = returned;
+	if (!left) return;
+
+	auto function = builder->GetInsertBlock()->getParent();
+	auto rhs = llvm::BasicBlock::Create(*context, is_and ? "and_rhs" : "or_rhs",
+										function);
+	auto end = llvm::BasicBlock::Create(*context, is_and ? "and_end" : "or_end",
+										function);
+	auto left_end = builder->GetInsertBlock();
+	if (is_and)
+		builder->CreateCondBr(left, rhs, end);
+	else
+		builder->CreateCondBr(left, end, rhs);
+
+	builder->SetInsertPoint(rhs);
+	it.RHS->accept(*this);
+	auto right = returned;
+	if (!right) return;
+	// the right side may have branched on its own
+	auto right_end = builder->GetInsertBlock();
+	builder->CreateBr(end);
+
+	builder->SetInsertPoint(end);
+	auto phi = builder->CreatePHI(left->getType(), 2);
+	phi->addIncoming(llvm::ConstantInt::getBool(*context, !is_and), left_end);
+	phi->addIncoming(right, right_end);
+	returned = phi;
+}
+
 void Generator::visit(BinaryExprAST &it) {
+	if (it.Op.type == TokenType::AND || it.Op.type == TokenType::OR) {
+		logical(it);
+		return;
+	}
+
 	it.LHS->accept(*this);
 	auto left = returned;
 	it.RHS->accept(*this);
 	auto right = returned;
 	if (!left || !right) return;
 
+	// the operands always share a type after type checking, vectors go by
+	// the type of their lanes
+	const TypeAST *type = it.LHS->checked_type;
+	if (type != nullptr) type = &type->scalar();
+	bool s = type != nullptr && type->isSigned();
+
+	// floats never overflow into ub, the builder adds the fast math flags
+	// of the current function
+	if (type != nullptr && type->isFloat()) {
+		switch (it.Op.type) {
+		case TokenType::PLUS:
+			returned = builder->CreateFAdd(left, right);
+			return;
+		case TokenType::MINUS:
+			returned = builder->CreateFSub(left, right);
+			return;
+		case TokenType::STAR:
+			returned = builder->CreateFMul(left, right);
+			return;
+		case TokenType::SLASH:
+			returned = builder->CreateFDiv(left, right);
+			return;
+		case TokenType::PERCENT:
+			returned = builder->CreateFRem(left, right);
+			return;
+		// ordered, so a nan compares false against everything
+		case TokenType::LESS:
+			returned = builder->CreateFCmpOLT(left, right);
+			return;
+		case TokenType::LESS_EQUAL:
+			returned = builder->CreateFCmpOLE(left, right);
+			return;
+		case TokenType::GREATER:
+			returned = builder->CreateFCmpOGT(left, right);
+			return;
+		case TokenType::GREATER_EQUAL:
+			returned = builder->CreateFCmpOGE(left, right);
+			return;
+		case TokenType::EQUAL_EQUAL:
+			returned = builder->CreateFCmpOEQ(left, right);
+			return;
+		// except for != which has to hold for a nan
+		case TokenType::BANG_EQUAL:
+			returned = builder->CreateFCmpUNE(left, right);
+			return;
+		default:
+			break;
+		}
+	}
+
 	switch (it.Op.type) {
-	case TokenType::PLUS: {
-		returned = builder->CreateAdd(left, right);
+	case TokenType::PLUS:
+		returned = arithmetic(llvm::Instruction::Add,
+							  s ? llvm::Intrinsic::sadd_with_overflow
+								: llvm::Intrinsic::uadd_with_overflow,
+							  left, right, s);
 		return;
-	}
 	case TokenType::MINUS:
-		returned = builder->CreateSub(left, right);
+		returned = arithmetic(llvm::Instruction::Sub,
+							  s ? llvm::Intrinsic::ssub_with_overflow
+								: llvm::Intrinsic::usub_with_overflow,
+							  left, right, s);
 		return;
 	case TokenType::STAR:
-		returned = builder->CreateMul(left, right);
+		returned = arithmetic(llvm::Instruction::Mul,
+							  s ? llvm::Intrinsic::smul_with_overflow
+								: llvm::Intrinsic::umul_with_overflow,
+							  left, right, s);
+		return;
+	case TokenType::SLASH:
+	case TokenType::PERCENT: {
+		bool div = it.Op.type == TokenType::SLASH;
+		// there is nothing to wrap a division by zero around to, so it traps
+		// under both policies that define what overflow does
+		if (overflow != Overflow::Undefined) {
+			auto zero = llvm::ConstantInt::get(right->getType(), 0);
+			llvm::Value *bad = builder->CreateICmpEQ(right, zero);
+			if (s) {
+				// INT_MIN / -1 does not fit either
+				auto bits = right->getType()->getScalarSizeInBits();
+				auto min = llvm::ConstantInt::get(
+					right->getType(), llvm::APInt::getSignedMinValue(bits));
+				auto minus_one =
+					llvm::ConstantInt::getSigned(right->getType(), -1);
+				auto overflows =
+					builder->CreateAnd(builder->CreateICmpEQ(left, min),
+									   builder->CreateICmpEQ(right, minus_one));
+				// wrapped it is INT_MIN with nothing left over, which is
+				// what dividing by one gives
+				if (overflow == Overflow::Wrap)
+					right = builder->CreateSelect(
+						overflows, llvm::ConstantInt::get(right->getType(), 1),
+						right);
+				else
+					bad = builder->CreateOr(bad, overflows);
+			}
+			trapIf(bad);
+		}
+		if (div)
+			returned = s ? builder->CreateSDiv(left, right)
+						 : builder->CreateUDiv(left, right);
+		else
+			returned = s ? builder->CreateSRem(left, right)
+						 : builder->CreateURem(left, right);
 		return;
+	}
+	case TokenType::LEFT_SHIFT:
+	case TokenType::RIGHT_SHIFT: {
+		// shifting by the width or more is poison in llvm
+		auto bits = left->getType()->getScalarSizeInBits();
+		auto width = llvm::ConstantInt::get(right->getType(), bits);
+		if (overflow == Overflow::Wrap)
+			right = builder->CreateURem(right, width);
+		else if (overflow == Overflow::Trap)
+			trapIf(builder->CreateICmpUGE(right, width));
+
+		if (it.Op.type == TokenType::LEFT_SHIFT)
+			returned = builder->CreateShl(left, right);
+		else
+			returned = s ? builder->CreateAShr(left, right)
+						 : builder->CreateLShr(left, right);
+		return;
+	}
 	case TokenType::LESS:
-		returned = builder->CreateICmpULT(left, right);
+		returned = s ? builder->CreateICmpSLT(left, right)
+					 : builder->CreateICmpULT(left, right);
+		return;
+	case TokenType::LESS_EQUAL:
+		returned = s ? builder->CreateICmpSLE(left, right)
+					 : builder->CreateICmpULE(left, right);
 		return;
 	case TokenType::GREATER:
-		returned = builder->CreateICmpUGT(left, right);
+		returned = s ? builder->CreateICmpSGT(left, right)
+					 : builder->CreateICmpUGT(left, right);
+		return;
+	case TokenType::GREATER_EQUAL:
+		returned = s ? builder->CreateICmpSGE(left, right)
+					 : builder->CreateICmpUGE(left, right);
+		return;
+	case TokenType::EQUAL_EQUAL:
+		returned = builder->CreateICmpEQ(left, right);
+		return;
+	case TokenType::BANG_EQUAL:
+		returned = builder->CreateICmpNE(left, right);
 		return;
 	default:
-		std::cout << "Unimplemented binary operation '" << it.Op.lexeme << "'"
-				  << std::endl;
+		error(it,
+			  fmt::format("cannot lower binary operator `{}`", it.Op.lexeme),
+			  "E0601");
 		return;
 	}
 }
 
 void Generator::visit(CallExprAST &it) {
-	llvm::Function *callee = llvm_module->getFunction(it.Callee);
-	if (!callee) {
-		std::cout << "Could not find function '" << it.Callee << "'"
-				  << std::endl;
+	if (it.builtin != CallExprAST::Builtin::None) {
+		builtin(it);
 		return;
 	}
 
-	if (callee->arg_size() != it.Args.size()) {
-		std::cout << "Call and fuction parity do not match" << std::endl;
-		return;
+	returned = call(it, nullptr);
+	if (!returned) return;
+
+	// a struct that came back some other way is only loaded as a whole where
+	// it is needed as one
+	auto &abi = abis.at(static_cast<PrototypeAST *>(it.resolved_name));
+	if (abi.result.pass != CallABI::Pass::Direct)
+		returned = builder->CreateLoad(abi.result.type, returned);
+}
+
+// where eightbyte `i` of the struct at `base` is
+static llvm::Value *eightbyte(llvm::IRBuilder<> &builder, llvm::Value *base,
+							  size_t i) {
+	return builder.CreateConstInBoundsGEP1_64(builder.getInt8Ty(), base,
+											  i * 8);
+}
+
+llvm::Value *Generator::call(CallExprAST &it, llvm::Value *into) {
+	using Pass = CallABI::Pass;
+
+	// a multiversioned function is an ifunc rather than a function
+	auto callee = llvm::dyn_cast_or_null<llvm::GlobalValue>(
+		llvm_module->getNamedValue(it.Callee));
+	auto proto = dynamic_cast<PrototypeAST *>(it.resolved_name);
+	if (!callee || !proto || !abis.contains(proto)) {
+		error(it, fmt::format("`{}` was never declared", it.Callee), "E0602");
+		return nullptr;
 	}
 
-	std::vector<llvm::Value *> args(it.Args.size());
-	for (int i = 0, e = it.Args.size(); i < e; i++) {
-		it.Args[i]->accept(*this);
-		auto a = returned;
-		if (!a) {
-			std::cout << "Unable to compile argument" << std::endl;
-			return;
+	auto &abi = abis.at(proto);
+	if (abi.params.size() != it.Args.size()) {
+		error(it,
+			  fmt::format("`{}` takes {} arguments but the call passes {}",
+						  it.Callee, abi.params.size(), it.Args.size()),
+			  "E0603");
+		return nullptr;
+	}
+
+	std::vector<llvm::Value *> args;
+	if (abi.result.pass == Pass::Memory) {
+		if (into == nullptr) into = entryAlloca(abi.result.type, "result");
+		args.push_back(into);
+	}
+
+	for (size_t i = 0; i < it.Args.size(); i++) {
+		auto &param = abi.params[i];
+		if (param.pass == Pass::Direct) {
+			it.Args[i]->accept(*this);
+			if (!returned) {
+				error(*it.Args[i],
+					  fmt::format("cannot lower argument {} of `{}`", i + 1,
+								  it.Callee),
+					  "E0604");
+				return nullptr;
+			}
+			args.push_back(returned);
+			continue;
+		}
+
+		// a struct is passed from wherever it is in memory, `byval` has the
+		// call make the copy the callee gets
+		auto arg = address(*it.Args[i]);
+		if (!arg) return nullptr;
+		if (param.pass == Pass::Memory) {
+			args.push_back(arg);
+			continue;
 		}
-		args[i] = a;
+		auto align = aligned(*it.Args[i]);
+		for (size_t k = 0; k < param.parts.size(); k++)
+			args.push_back(builder->CreateAlignedLoad(
+				param.parts[k], eightbyte(*builder, arg, k),
+				llvm::commonAlignment(align, k * 8)));
 	}
 
-	returned = builder->CreateCall(callee, args);
+	auto result = builder->CreateCall(abi.lowered, callee, args);
+	abi.annotate(*result);
+	if (abi.result.pass != Pass::Split) return into ? into : result;
+
+	if (into == nullptr) into = entryAlloca(abi.result.type, "result");
+	auto align = alignment(abi.result.type);
+	auto &parts = abi.result.parts;
+	for (size_t k = 0; k < parts.size(); k++) {
+		auto part = parts.size() == 1
+						? static_cast<llvm::Value *>(result)
+						: builder->CreateExtractValue(result, k);
+		builder->CreateAlignedStore(part, eightbyte(*builder, into, k),
+									llvm::commonAlignment(align, k * 8));
+	}
+	return into;
 }
 
 void Generator::visit(NumberExprAST &it) {
-	returned = llvm::ConstantInt::get(*context,
-									  llvm::APInt(32, atoi(it.value.c_str())));
+	// literals take the type the checker gave them, i32 otherwise
+	if (it.checked_type == nullptr) {
+		returned = llvm::ConstantInt::get(
+			*context, llvm::APInt(32, atoi(it.value.c_str())));
+		return;
+	}
+
+	it.checked_type->accept(*this);
+	if (it.checked_type->isFloat())
+		returned = llvm::ConstantFP::get(returned_type, it.value);
+	else
+		returned = llvm::ConstantInt::get(
+			llvm::cast<llvm::IntegerType>(returned_type), it.value, 10);
 }
 
 void Generator::visit(StringLiteralAST &it) {}
-void Generator::visit(BoolLiteralAST &it) {}
-void Generator::visit(StructLiteralAST &it) {}
+void Generator::visit(BoolLiteralAST &it) {
+	returned = llvm::ConstantInt::getBool(*context, it.value);
+}
+void Generator::visit(StructLiteralAST &it) {
+	it.checked_type->accept(*this);
+	llvm::Value *value = llvm::UndefValue::get(returned_type);
+	for (size_t i = 0; i < it.values.size(); i++) {
+		it.values[i]->accept(*this);
+		if (!returned) return;
+		value = builder->CreateInsertValue(
+			value, returned, field(*it.checked_type, it.fields[i]));
+	}
+	returned = value;
+}
+
+void Generator::visit(ArrayLiteralAST &it) {
+	it.checked_type->accept(*this);
+	llvm::Value *array = llvm::PoisonValue::get(returned_type);
+	bool vector = it.checked_type->isVector();
+
+	for (unsigned i = 0; i < it.elements.size(); i++) {
+		it.elements[i]->accept(*this);
+		array = vector ? builder->CreateInsertElement(array, returned, i)
+					   : builder->CreateInsertValue(array, returned, i);
+	}
+
+	returned = array;
+}
+
+void Generator::visit(IndexExprAST &it) {
+	// a vector is a value in a register, its lanes are not in memory
+	if (it.array->checked_type->isVector()) {
+		it.array->accept(*this);
+		auto vector = returned;
+		auto lane = offset(*it.index, it.array->checked_type->length, 1,
+						   it.checked);
+		if (vector && lane)
+			returned = builder->CreateExtractElement(vector, lane);
+		return;
+	}
+
+	auto element = address(it);
+	if (element == nullptr) return;
+
+	auto align = aligned(it);
+	it.checked_type->accept(*this);
+	returned = builder->CreateAlignedLoad(returned_type, element, align);
+}
+
+llvm::Value *Generator::offset(ExprAST &index, uint64_t length, uint64_t count,
+							   bool checked) {
+	index.accept(*this);
+	llvm::Value *i = returned;
+	if (!i) return nullptr;
+
+	// widened to the size of a pointer, a negative signed index turns into
+	// a huge unsigned one which the one comparison below catches as well
+	auto i64 = builder->getInt64Ty();
+	if (i->getType()->getIntegerBitWidth() < 64)
+		i = index.checked_type->isSigned() ? builder->CreateSExt(i, i64)
+										   : builder->CreateZExt(i, i64);
+
+	if (checked)
+		trapIf(builder->CreateICmpUGE(
+			i, llvm::ConstantInt::get(i->getType(), length - count + 1)));
+	if (i->getType()->getIntegerBitWidth() > 64)
+		i = builder->CreateTrunc(i, i64);
+	return i;
+}
+
+llvm::Value *Generator::element(ExprAST &array, ExprAST &index,
+								uint64_t count, bool checked) {
+	auto base = address(array);
+	if (base == nullptr) return nullptr;
+	auto i = offset(index, array.checked_type->length, count, checked);
+	if (i == nullptr) return nullptr;
+
+	array.checked_type->accept(*this);
+	return builder->CreateInBoundsGEP(returned_type, base,
+									  {builder->getInt64(0), i});
+}
+
+llvm::Type *Generator::stored(llvm::Value *variable) {
+	if (auto alloca = llvm::dyn_cast_or_null<llvm::AllocaInst>(variable))
+		return alloca->getAllocatedType();
+	if (auto arg = llvm::dyn_cast_or_null<llvm::Argument>(variable);
+		arg && arg->hasByValAttr())
+		return arg->getParamByValType();
+	if (auto global = llvm::dyn_cast_or_null<llvm::GlobalVariable>(variable))
+		return global->getValueType();
+	return nullptr;
+}
+
+// a call putting its struct result in memory, rather than returning it
+static bool indirect(Generator &gen, ExprAST &expr) {
+	auto call = dynamic_cast<CallExprAST *>(&expr);
+	auto proto = call ? dynamic_cast<PrototypeAST *>(call->resolved_name)
+					  : nullptr;
+	return proto != nullptr && gen.abis.contains(proto) &&
+		   gen.abis.at(proto).result.pass != CallABI::Pass::Direct;
+}
+
+llvm::Value *Generator::placed(ExprAST &expr) {
+	if (auto variable = dynamic_cast<VariableExprAST *>(&expr)) {
+		auto value = values[variable->resolved_name];
+		return stored(value) ? value : nullptr;
+	}
+	if (dynamic_cast<DerefExprAST *>(&expr) ||
+		dynamic_cast<IndexExprAST *>(&expr) ||
+		dynamic_cast<StructMemberAccessAST *>(&expr) || indirect(*this, expr))
+		return address(expr);
+	return nullptr;
+}
+
+llvm::Value *Generator::address(ExprAST &expr) {
+	if (auto variable = dynamic_cast<VariableExprAST *>(&expr)) {
+		auto value = values[variable->resolved_name];
+		if (stored(value)) return value;
+	}
+
+	// a reference is the address of what it points to
+	if (auto deref = dynamic_cast<DerefExprAST *>(&expr)) {
+		deref->pointer->accept(*this);
+		return returned;
+	}
+
+	if (auto index = dynamic_cast<IndexExprAST *>(&expr))
+		return element(*index->array, *index->index, 1, index->checked);
+
+	if (auto member = dynamic_cast<StructMemberAccessAST *>(&expr)) {
+		auto base = address(*member->parent);
+		if (!base) return nullptr;
+		auto &type = *member->parent->checked_type;
+		type.accept(*this);
+		return builder->CreateStructGEP(returned_type, base,
+										field(type, member->index));
+	}
+
+	if (indirect(*this, expr))
+		return call(static_cast<CallExprAST &>(expr), nullptr);
+
+	// anything else is a value, which needs a place in memory before its
+	// elements can be picked out
+	expr.accept(*this);
+	if (!returned) return nullptr;
+	auto tmp = entryAlloca(returned->getType(), "tmp");
+	builder->CreateStore(returned, tmp);
+	return tmp;
+}
+
+void Generator::copy(llvm::Value *into, llvm::Align align, ExprAST &value,
+					 bool fresh) {
+	auto type = value.checked_type;
+	if (type == nullptr || type->type != TypeAST::Type::_struct) {
+		value.accept(*this);
+		if (returned) builder->CreateAlignedStore(returned, into, align);
+		return;
+	}
+	type->accept(*this);
+	auto struct_type = llvm::cast<llvm::StructType>(returned_type);
+	auto &layout = llvm_module->getDataLayout();
+
+	// memory that cannot be read while it is written takes a literal one
+	// member at a time, and a struct returned in memory straight from the
+	// call, unless it is a member less aligned than the call expects
+	if (auto literal = dynamic_cast<StructLiteralAST *>(&value); fresh) {
+		if (literal) {
+			auto offsets = layout.getStructLayout(struct_type);
+			for (size_t i = 0; i < literal->values.size(); i++) {
+				auto element = field(*type, literal->fields[i]);
+				copy(builder->CreateStructGEP(struct_type, into, element),
+					 llvm::commonAlignment(
+						 align, offsets->getElementOffset(element)),
+					 *literal->values[i], true);
+			}
+			return;
+		}
+		if (indirect(*this, value) && align >= alignment(struct_type)) {
+			call(static_cast<CallExprAST &>(value), into);
+			return;
+		}
+	}
+
+	auto from = placed(value);
+	if (from == nullptr) {
+		value.accept(*this);
+		if (returned) builder->CreateAlignedStore(returned, into, align);
+		return;
+	}
+
+	// the source may be the destination itself unless it is fresh
+	auto source = aligned(value);
+	auto size = layout.getTypeAllocSize(struct_type);
+	if (fresh)
+		builder->CreateMemCpy(into, align, from, source, size);
+	else
+		builder->CreateMemMove(into, align, from, source, size);
+}
+
+void Generator::visit(RefExprAST &it) { returned = address(*it.target); }
+
+void Generator::visit(DerefExprAST &it) {
+	auto pointer = address(it);
+	if (pointer == nullptr) return;
+
+	it.checked_type->accept(*this);
+	returned = builder->CreateLoad(returned_type, pointer);
+}
 
 void Generator::visit(VariableExprAST &it) {
-	std::cout << it.name << std::endl;
-	returned = it.resolved_name->llvm_value;
+	returned = values[it.resolved_name];
+
+	// `let mut` locals live in memory, everything else is the value itself
+	if (auto type = stored(returned))
+		returned = builder->CreateLoad(type, returned, it.name);
+}
+
+void Generator::visit(StructMemberAccessAST &it) {
+	// a member of a struct in memory is loaded on its own rather than with
+	// the rest of the struct
+	auto element = field(*it.parent->checked_type, it.index);
+	if (auto base = placed(*it.parent)) {
+		it.parent->checked_type->accept(*this);
+		auto member =
+			builder->CreateStructGEP(returned_type, base, element, it.name);
+		auto align = aligned(it);
+		it.checked_type->accept(*this);
+		returned =
+			builder->CreateAlignedLoad(returned_type, member, align, it.name);
+		return;
+	}
+
+	it.parent->accept(*this);
+	if (returned) returned = builder->CreateExtractValue(returned, element);
+}
+
+void Generator::visit(LayoutExprAST &it) {
+	it.type->accept(*this);
+	auto type = returned_type;
+	auto &layout = llvm_module->getDataLayout();
+
+	uint64_t value = 0;
+	switch (it.query) {
+	case LayoutExprAST::Query::Size:
+		// the stride of an array of them, like C
+		value = layout.getTypeAllocSize(type);
+		break;
+	case LayoutExprAST::Query::Align:
+		value = alignment(type).value();
+		break;
+	case LayoutExprAST::Query::Offset:
+		value = layout.getStructLayout(llvm::cast<llvm::StructType>(type))
+					->getElementOffset(field(*it.type, it.index));
+		break;
+	}
+
+	it.checked_type->accept(*this);
+	returned = llvm::ConstantInt::get(returned_type, value);
+}
+
+llvm::Align Generator::alignment(llvm::Type *type) {
+	if (auto array = llvm::dyn_cast<llvm::ArrayType>(type))
+		return alignment(array->getElementType());
+	auto s = llvm::dyn_cast<llvm::StructType>(type);
+	if (s != nullptr && layouts.contains(s)) return layouts[s].align;
+	return llvm_module->getDataLayout().getABITypeAlign(type);
+}
+
+unsigned Generator::field(const TypeAST &type, size_t index) {
+	return layouts.at(struct_types.at(type.resolved_name)).fields[index];
+}
+
+llvm::Align Generator::aligned(ExprAST &place) {
+	auto &layout = llvm_module->getDataLayout();
+
+	// an element is as aligned as its array, up to its own size
+	auto index = dynamic_cast<IndexExprAST *>(&place);
+	if (index != nullptr && !index->array->checked_type->isVector()) {
+		index->checked_type->accept(*this);
+		return llvm::commonAlignment(aligned(*index->array),
+									 layout.getTypeAllocSize(returned_type));
+	}
+
+	// a member is as aligned as its struct, up to its offset in it
+	if (auto member = dynamic_cast<StructMemberAccessAST *>(&place)) {
+		auto &type = *member->parent->checked_type;
+		type.accept(*this);
+		auto offsets =
+			layout.getStructLayout(llvm::cast<llvm::StructType>(returned_type));
+		return llvm::commonAlignment(
+			aligned(*member->parent),
+			offsets->getElementOffset(field(type, member->index)));
+	}
+
+	place.checked_type->accept(*this);
+	return alignment(returned_type);
 }
 
 void breadth_function_define(FunctionAST *, Generator &);
 void breadth_struct_define(StructAST *, Generator &);
+void breadth_const_define(VarDecl *, Generator &);
 void Generator::visit(FileAST &it) {
-	std::cout << "file time baby!\n";
 	// need to do a struct pass then function pass because functions can return
 	// a struct that has not been defined yet
 	for (auto child : it.getChildren()) {
-		if (auto s = dynamic_cast<StructAST *>(child))
+		if (auto s = dynamic_cast<StructAST *>(child); s && s->used)
 			breadth_struct_define(s, *this);
 	}
+	// how a function passes a struct depends on its layout, so the bodies
+	// come before any function is declared
+	for (auto child : it.getChildren()) {
+		if (auto s = dynamic_cast<StructAST *>(child); s && s->used)
+			s->accept(*this);
+	}
+	for (auto child : it.getChildren()) {
+		if (auto c = dynamic_cast<VarDecl *>(child))
+			breadth_const_define(c, *this);
+	}
 	for (auto child : it.getChildren()) {
 		FunctionAST *c = dynamic_cast<FunctionAST *>(child);
-		if (c != nullptr) breadth_function_define(c, *this);
+		if (c != nullptr && c->used) breadth_function_define(c, *this);
 	}
 
 	for (auto child : it.getChildren()) {
+		if (dynamic_cast<VarDecl *>(child)) continue;
+		if (dynamic_cast<StructAST *>(child)) continue;
+		// other partitions emit the bodies of the functions they own
+		if (auto f = dynamic_cast<FunctionAST *>(child);
+			f && (!f->used || !owned.contains(f)))
+			continue;
 		child->accept(*this);
 	}
 
-	llvm::verifyModule(*llvm_module);
-	llvm_module->print(llvm::errs(), nullptr);
+	// partitions are generated in parallel, so keep the report until the
+	// driver prints them in order
+	llvm::raw_string_ostream os(errors);
+	broken |= llvm::verifyModule(*llvm_module, &os);
 	return;
 }
 
@@ -124,24 +787,297 @@ void Generator::visit(FunctionAST &it) {
 
 	if (!func) {
 		it.proto->accept(*this);
-		func = (llvm::Function *)returned;
+		func = llvm::dyn_cast_or_null<llvm::Function>(returned);
 	}
 	if (!func) return;
 
 	if (!func->empty()) {
-		std::cout << "Cannot redefine function '" << it.proto->name << "'"
-				  << std::endl;
+		error(it, fmt::format("`{}` is defined more than once", it.proto->name),
+			  "E0605");
+		return;
+	}
+
+	if (auto clones = it.proto->attribute("target_clones")) {
+		multiversion(it, func, *clones);
 		return;
 	}
 
+	body(it, func);
+	returned = func;
+}
+
+void Generator::body(FunctionAST &it, llvm::Function *func) {
 	llvm::BasicBlock *bodyBlock =
 		llvm::BasicBlock::Create(*context, "entry", func);
 	builder->SetInsertPoint(bodyBlock);
+	builder->setFastMathFlags(fastMath(*it.proto));
+
+	signature = &abis.at(it.proto.get());
+	for (size_t i = 0; i < it.proto->parameters.size(); i++) {
+		auto param = it.proto->parameters[i].get();
+		auto &abi = signature->params[i];
+		auto arg = func->getArg(signature->argument(i));
+		values[param] = arg;
+
+		// a struct in registers is put back together in memory, where its
+		// members are read from
+		if (abi.pass == CallABI::Pass::Split) {
+			auto copy = entryAlloca(abi.type, param->name);
+			for (size_t k = 0; k < abi.parts.size(); k++)
+				builder->CreateAlignedStore(
+					func->getArg(signature->argument(i) + k),
+					eightbyte(*builder, copy, k),
+					llvm::commonAlignment(copy->getAlign(), k * 8));
+			values[param] = copy;
+		}
+
+		// arrays are indexed in memory, so they get a copy there once
+		if (arg->getType()->isArrayTy()) {
+			auto copy = entryAlloca(arg->getType(), param->name);
+			builder->CreateStore(arg, copy);
+			values[param] = copy;
+		}
+	}
 
 	it.body->accept(*this);
 
-	llvm::verifyFunction(*func);
-	returned = func;
+	// every path that matters returned, whatever is left (like the join block
+	// of an if where both arms return) can never be reached
+	for (auto &block : *func)
+		if (block.getTerminator() == nullptr) {
+			builder->SetInsertPoint(&block);
+			builder->CreateUnreachable();
+		}
+}
+
+// best first, the resolver takes the first one the cpu has. The bits are the
+// ones libgcc and compiler-rt fill __cpu_model.features with
+const std::vector<Generator::CloneTarget> &Generator::cloneTargets() {
+	static const std::vector<CloneTarget> targets = {
+		{"avx512bw", 21}, {"avx512vl", 20}, {"avx512dq", 22},
+		{"avx512f", 15},  {"avx2", 10},		{"fma", 14},
+		{"bmi2", 17},	  {"avx", 9},		{"sse4.2", 8},
+		{"popcnt", 2},
+	};
+	return targets;
+}
+
+std::optional<std::vector<Generator::LoopHint>>
+Generator::parseLoopHint(const Attribute &attribute) {
+	auto &args = attribute.args;
+	std::optional<uint32_t> count;
+	if (args.size() == 1) {
+		uint32_t n;
+		if (!llvm::StringRef(args[0].value).getAsInteger(10, n) && n > 0)
+			count = n;
+	}
+	bool bare = args.empty();
+	bool disable = args.size() == 1 && args[0].key.empty() &&
+				   args[0].value == "disable";
+
+	if (attribute.name == "vectorize") {
+		// a width of one is how llvm spells not vectorizing at all
+		if (disable)
+			return std::vector<LoopHint>{{"llvm.loop.vectorize.width", 1}};
+		if (bare)
+			return std::vector<LoopHint>{
+				{"llvm.loop.vectorize.enable", 1, true}};
+		if (count && args[0].key == "width")
+			return std::vector<LoopHint>{
+				{"llvm.loop.vectorize.enable", 1, true},
+				{"llvm.loop.vectorize.width", count}};
+	} else if (attribute.name == "unroll") {
+		if (disable) return std::vector<LoopHint>{{"llvm.loop.unroll.disable"}};
+		if (bare) return std::vector<LoopHint>{{"llvm.loop.unroll.enable"}};
+		if (args.size() == 1 && args[0].key.empty() &&
+			args[0].value == "full")
+			return std::vector<LoopHint>{{"llvm.loop.unroll.full"}};
+		if (count && args[0].key.empty())
+			return std::vector<LoopHint>{{"llvm.loop.unroll.count", count}};
+	} else if (attribute.name == "interleave") {
+		if (disable)
+			return std::vector<LoopHint>{{"llvm.loop.interleave.count", 1}};
+		if (count && args[0].key.empty())
+			return std::vector<LoopHint>{
+				{"llvm.loop.interleave.count", count}};
+	}
+	return std::nullopt;
+}
+
+void Generator::loopHints(const AST &loop, llvm::BasicBlock *latch) {
+	std::vector<llvm::Metadata *> properties;
+	for (auto &a : loop.attributes) {
+		// TypeCheck already rejected malformed hints
+		auto hints = parseLoopHint(a);
+		if (!hints) continue;
+
+		for (auto &hint : *hints) {
+			std::vector<llvm::Metadata *> operands = {
+				llvm::MDString::get(*context, hint.property)};
+			if (hint.value) {
+				auto type = hint.boolean ? builder->getInt1Ty()
+										 : builder->getInt32Ty();
+				operands.push_back(llvm::ConstantAsMetadata::get(
+					llvm::ConstantInt::get(type, *hint.value)));
+			}
+			properties.push_back(llvm::MDNode::get(*context, operands));
+		}
+	}
+
+	auto branch = latch->getTerminator();
+	if (properties.empty() || branch == nullptr) return;
+
+	// a loop id is distinct and refers to itself first, so two loops with
+	// the same hints never share one
+	properties.insert(properties.begin(), nullptr);
+	auto id = llvm::MDNode::getDistinct(*context, properties);
+	id->replaceOperandWith(0, id);
+	branch->setMetadata(llvm::LLVMContext::MD_loop, id);
+	hinted_loops.emplace(id, loop.loc);
+}
+
+void Generator::multiversion(FunctionAST &it, llvm::Function *func,
+							 const Attribute &clones) {
+	// the cpu check is x86 only, any other target gets the portable version
+	llvm::Triple triple(llvm_module->getTargetTriple());
+	if (!triple.isX86()) {
+		body(it, func);
+		returned = func;
+		return;
+	}
+
+	auto name = it.proto->name;
+	auto type = func->getFunctionType();
+	auto clone = [&](const std::string &suffix) {
+		auto f = llvm::Function::Create(type, llvm::Function::InternalLinkage,
+										name + "." + suffix, *llvm_module);
+		f->setAttributes(func->getAttributes());
+		for (size_t i = 0; i < f->arg_size(); i++)
+			f->getArg(i)->setName(func->getArg(i)->getName());
+		return f;
+	};
+
+	auto fallback = clone("default");
+	body(it, fallback);
+
+	std::vector<std::pair<const CloneTarget *, llvm::Function *>> versions;
+	for (auto &target : cloneTargets()) {
+		bool wanted = false;
+		for (auto &arg : clones.args)
+			wanted |= arg.value == target.name;
+		if (!wanted) continue;
+
+		auto f = clone(target.name);
+		// codegen adds the module's own features in front of these
+		f->addFnAttr("target-features", "+" + target.name);
+		body(it, f);
+		versions.emplace_back(&target, f);
+	}
+
+	auto ptr = llvm::PointerType::get(*context, 0);
+	auto resolver = llvm::Function::Create(
+		llvm::FunctionType::get(ptr, false), llvm::Function::InternalLinkage,
+		name + ".resolver", *llvm_module);
+	builder->SetInsertPoint(
+		llvm::BasicBlock::Create(*context, "entry", resolver));
+
+	// resolvers run while relocating, before any constructor has had the
+	// chance to fill in the cpu model
+	auto init = llvm_module->getOrInsertFunction(
+		"__cpu_indicator_init", llvm::Type::getVoidTy(*context));
+	builder->CreateCall(init);
+
+	auto i32 = builder->getInt32Ty();
+	auto model_type = llvm::StructType::get(
+		*context, {i32, i32, i32, llvm::ArrayType::get(i32, 1)});
+	auto model = llvm_module->getOrInsertGlobal("__cpu_model", model_type);
+	auto word = builder->CreateInBoundsGEP(
+		model_type, model,
+		{builder->getInt32(0), builder->getInt32(3), builder->getInt32(0)});
+	auto features = builder->CreateLoad(i32, word, "features");
+
+	for (auto [target, f] : versions) {
+		auto bit = builder->getInt32(1u << target->bit);
+		auto has = builder->CreateICmpNE(builder->CreateAnd(features, bit),
+										 builder->getInt32(0));
+		auto yes = llvm::BasicBlock::Create(*context, target->name, resolver);
+		auto no = llvm::BasicBlock::Create(*context, "next", resolver);
+		builder->CreateCondBr(has, yes, no);
+
+		builder->SetInsertPoint(yes);
+		builder->CreateRet(f);
+		builder->SetInsertPoint(no);
+	}
+	builder->CreateRet(fallback);
+
+	if (!ifuncs || !triple.isOSBinFormatELF()) {
+		dispatch(func, resolver);
+		returned = func;
+		return;
+	}
+
+	// callers go through the ifunc, which the loader points at the version
+	// the resolver picked
+	auto ifunc = llvm::GlobalIFunc::create(type, 0, func->getLinkage(), "",
+										   resolver, llvm_module.get());
+	ifunc->takeName(func);
+	func->replaceAllUsesWith(ifunc);
+	func->eraseFromParent();
+
+	values[&it] = ifunc;
+	returned = ifunc;
+}
+
+void Generator::dispatch(llvm::Function *func, llvm::Function *resolver) {
+	// without a loader to run the resolver, the function asks it on the first
+	// call and keeps the answer. Racing threads all store the same version
+	auto ptr = resolver->getReturnType();
+	auto null = llvm::ConstantPointerNull::get(
+		llvm::cast<llvm::PointerType>(ptr));
+	auto slot = new llvm::GlobalVariable(*llvm_module, ptr, false,
+										 llvm::GlobalValue::InternalLinkage,
+										 null, func->getName() + ".version");
+	auto align = llvm_module->getDataLayout().getPointerABIAlignment(0);
+
+	// what the body does holds for the versions, the stub itself also
+	// writes the slot and runs the resolver, which writes the cpu model
+	auto attributes = func->getAttributes();
+	func->setMemoryEffects(llvm::MemoryEffects::unknown());
+	func->removeFnAttr(llvm::Attribute::WillReturn);
+
+	auto entry = llvm::BasicBlock::Create(*context, "entry", func);
+	auto resolve = llvm::BasicBlock::Create(*context, "resolve", func);
+	auto call = llvm::BasicBlock::Create(*context, "call", func);
+
+	builder->SetInsertPoint(entry);
+	auto known = builder->CreateAlignedLoad(ptr, slot, align);
+	known->setAtomic(llvm::AtomicOrdering::Monotonic);
+	auto weights = llvm::MDBuilder(*context).createBranchWeights(1, 1 << 20);
+	builder->CreateCondBr(builder->CreateICmpEQ(known, null), resolve, call,
+						  weights);
+
+	builder->SetInsertPoint(resolve);
+	auto picked = builder->CreateCall(resolver);
+	builder->CreateAlignedStore(picked, slot, align)
+		->setAtomic(llvm::AtomicOrdering::Monotonic);
+	builder->CreateBr(call);
+
+	builder->SetInsertPoint(call);
+	auto version = builder->CreatePHI(ptr, 2);
+	version->addIncoming(known, entry);
+	version->addIncoming(picked, resolve);
+
+	std::vector<llvm::Value *> args;
+	for (auto &arg : func->args())
+		args.push_back(&arg);
+	auto result = builder->CreateCall(func->getFunctionType(), version, args);
+	// a musttail call has to pass `sret` and `byval` the same way
+	result->setAttributes(attributes);
+	result->setTailCallKind(llvm::CallInst::TCK_MustTail);
+	if (func->getReturnType()->isVoidTy())
+		builder->CreateRetVoid();
+	else
+		builder->CreateRet(result);
 }
 
 // not called due to the breadth pass
@@ -149,18 +1085,79 @@ void Generator::visit(PrototypeAST &) {}
 void Generator::visit(ParameterAST &) {}
 
 void Generator::visit(ReturnStmt &it) {
-	if (it.value) {
-		it.value.value()->accept(*this);
+	if (!it.value) {
+		builder->CreateRetVoid();
+		return;
+	}
+
+	auto &value = *it.value.value();
+	auto &result = signature->result;
+	switch (result.pass) {
+	case CallABI::Pass::Direct:
+		value.accept(*this);
 		builder->CreateRet(returned);
-	} else
+		return;
+	case CallABI::Pass::Memory: {
+		// the caller's memory for the result is out of reach of everything
+		// in the function
+		auto function = builder->GetInsertBlock()->getParent();
+		copy(function->getArg(0), result.align, value, true);
 		builder->CreateRetVoid();
+		return;
+	}
+	case CallABI::Pass::Split: {
+		auto from = address(value);
+		if (!from) return;
+		auto align = aligned(value);
+		llvm::Value *parts = llvm::UndefValue::get(signature->returned());
+		for (size_t k = 0; k < result.parts.size(); k++) {
+			auto part = builder->CreateAlignedLoad(
+				result.parts[k], eightbyte(*builder, from, k),
+				llvm::commonAlignment(align, k * 8));
+			if (result.parts.size() == 1) {
+				parts = part;
+				break;
+			}
+			parts = builder->CreateInsertValue(parts, part, k);
+		}
+		builder->CreateRet(parts);
+		return;
+	}
+	}
+}
 
-	return;
+llvm::Value *Generator::branchCondition(ExprAST &condition,
+										std::optional<bool> &expect) {
+	using B = CallExprAST::Builtin;
+	auto call = dynamic_cast<CallExprAST *>(&condition);
+	if (call == nullptr ||
+		(call->builtin != B::Likely && call->builtin != B::Unlikely)) {
+		condition.accept(*this);
+		return returned;
+	}
+
+	expect = call->builtin == B::Likely;
+	call->Args[0]->accept(*this);
+	return returned;
+}
+
+llvm::MDNode *Generator::branchWeights(std::optional<bool> expect) {
+	if (!expect) return nullptr;
+
+	// the odds clang gives __builtin_expect
+	llvm::MDBuilder md(*context);
+	return *expect ? md.createBranchWeights(2000, 1)
+				   : md.createBranchWeights(1, 2000);
 }
 
 void Generator::visit(IfStmt &it) {
-	it.condition->accept(*this);
-	auto cond = returned;
+	std::optional<bool> expect;
+	auto cond = branchCondition(*it.condition, expect);
+	// an arm marked cold is as good as the condition saying it is unlikely
+	bool cold = it.block->attribute("cold");
+	bool cold_else = it.else_ && it.else_.value()->attribute("cold");
+	if (cold != cold_else) expect = cold_else;
+	auto weights = branchWeights(expect);
 	auto function = builder->GetInsertBlock()->getParent();
 	auto true_block = llvm::BasicBlock::Create(*context, "if_true", function);
 
@@ -172,14 +1169,15 @@ void Generator::visit(IfStmt &it) {
 	if (!it.else_.has_value()) {
 		builder->SetInsertPoint(true_block);
 		it.block->accept(*this);
+		auto true_end = builder->GetInsertBlock();
 
 		auto final_block =
 			llvm::BasicBlock::Create(*context, "if_return", function);
 
-		builder->CreateBr(final_block);
+		fallthrough(true_end, final_block);
 
 		builder->SetInsertPoint(ip);
-		builder->CreateCondBr(cond, true_block, final_block);
+		builder->CreateCondBr(cond, true_block, final_block, weights);
 
 		builder->SetInsertPoint(final_block);
 		return;
@@ -187,23 +1185,25 @@ void Generator::visit(IfStmt &it) {
 
 	builder->SetInsertPoint(true_block);
 	it.block->accept(*this);
+	auto true_end = builder->GetInsertBlock();
 
 	llvm::BasicBlock *false_block =
 		llvm::BasicBlock::Create(*context, "if_else", function);
 
 	builder->SetInsertPoint(false_block);
 	it.else_.value()->accept(*this);
+	auto false_end = builder->GetInsertBlock();
 
 	auto final_block =
 		llvm::BasicBlock::Create(*context, "if_return", function);
 
-	builder->CreateBr(final_block);
-
-	builder->SetInsertPoint(true_block);
-	builder->CreateBr(final_block);
+	// nested statements move the insert point, so close off the blocks the
+	// arms ended in rather than the ones they started in
+	fallthrough(false_end, final_block);
+	fallthrough(true_end, final_block);
 
 	builder->SetInsertPoint(ip);
-	builder->CreateCondBr(cond, true_block, false_block);
+	builder->CreateCondBr(cond, true_block, false_block, weights);
 
 	builder->SetInsertPoint(final_block);
 
@@ -219,31 +1219,163 @@ void Generator::visit(WhileStmt &it) {
 	auto block = llvm::BasicBlock::Create(*context, "while_block", func);
 	builder->SetInsertPoint(block);
 	it.block->accept(*this);
-	builder->CreateBr(cond_block);
+	// a body that always returns never comes back around, it has no
+	// back-edge to put hints on
+	auto latch = builder->GetInsertBlock();
+	bool loops = latch->getTerminator() == nullptr;
+	fallthrough(latch, cond_block);
+	if (loops) loopHints(it, latch);
 
 	builder->SetInsertPoint(cond_block);
-	it.condition->accept(*this);
-	auto cond = returned;
+	std::optional<bool> expect;
+	auto cond = branchCondition(*it.condition, expect);
 	auto end = llvm::BasicBlock::Create(*context, "while_return", func);
-	builder->CreateCondBr(cond, block, end);
+	builder->CreateCondBr(cond, block, end, branchWeights(expect));
 	builder->SetInsertPoint(end);
 
 	return;
 }
 
+void Generator::visit(ForStmt &it) {
+	auto func = builder->GetInsertBlock()->getParent();
+	auto name = it.variable->name;
+	auto done = llvm::BasicBlock::Create(*context, "for_return", func);
+
+	// the loop counts from zero up to the number of iterations, which the
+	// vectorizer and unroller recognize far more readily than a condition
+	// they have to work out the trip count from
+	if (it.array) {
+		auto length = it.array->checked_type->length;
+		auto array = address(*it.array);
+		if (array == nullptr) return;
+		if (length == 0) {
+			builder->CreateBr(done);
+			builder->SetInsertPoint(done);
+			return;
+		}
+
+		emitFor(it, done, builder->getInt64(length), [&](llvm::Value *count) {
+			// the count never reaches the length, so no check is needed
+			it.array->checked_type->accept(*this);
+			auto element = builder->CreateInBoundsGEP(
+				returned_type, array, {builder->getInt64(0), count});
+			it.variable->type->accept(*this);
+			return builder->CreateLoad(returned_type, element, name);
+		});
+		return;
+	}
+
+	it.start->accept(*this);
+	auto start = returned;
+	it.end->accept(*this);
+	auto end = returned;
+	if (!start || !end) return;
+
+	bool s = it.variable->type->isSigned();
+	llvm::Value *step = llvm::ConstantInt::get(start->getType(), 1);
+	if (it.step) {
+		it.step.value()->accept(*this);
+		step = returned;
+		if (!step) return;
+		// a step of zero or less would never get to the end, which is an
+		// error when it is known here and a trap otherwise
+		auto known = llvm::dyn_cast<llvm::ConstantInt>(step);
+		if (known != nullptr &&
+			(s ? known->getValue().isNonPositive() : known->isZero())) {
+			error(*it.step.value(), "the step of a range has to be positive",
+				  "E0316");
+			return;
+		}
+		if (known == nullptr) {
+			auto zero = llvm::ConstantInt::get(step->getType(), 0);
+			trapIf(s ? builder->CreateICmpSLE(step, zero)
+					 : builder->CreateICmpEQ(step, zero));
+		}
+	}
+	auto one = llvm::dyn_cast<llvm::ConstantInt>(step);
+	bool unit = one != nullptr && one->isOne();
+
+	auto enter = s ? builder->CreateICmpSLT(start, end)
+				   : builder->CreateICmpULT(start, end);
+	auto preheader = llvm::BasicBlock::Create(*context, "for_init", func);
+	builder->CreateCondBr(enter, preheader, done);
+	builder->SetInsertPoint(preheader);
+
+	// (end - start - 1) / step + 1, which cannot overflow with start below end
+	auto unit_of = [&](llvm::Value *v) {
+		return llvm::ConstantInt::get(v->getType(), 1);
+	};
+	llvm::Value *trip = builder->CreateSub(end, start, name + ".trip");
+	if (!unit) {
+		trip = builder->CreateNUWSub(trip, unit_of(trip));
+		trip = builder->CreateNUWAdd(builder->CreateUDiv(trip, step),
+									 unit_of(trip), name + ".trip");
+	}
+
+	emitFor(it, done, trip, [&](llvm::Value *count) {
+		// start + count * step stays inside the range, but a signed range may
+		// be wider than the largest signed value
+		auto offset = unit ? count : builder->CreateNUWMul(count, step);
+		return builder->CreateAdd(start, offset, name, !s, false);
+	});
+}
+
+void Generator::emitFor(ForStmt &it, llvm::BasicBlock *done,
+						llvm::Value *trip,
+						const std::function<llvm::Value *(llvm::Value *)> &at) {
+	auto func = builder->GetInsertBlock()->getParent();
+	auto entry = builder->GetInsertBlock();
+	auto body = llvm::BasicBlock::Create(*context, "for_block", func);
+	builder->CreateBr(body);
+
+	builder->SetInsertPoint(body);
+	auto type = trip->getType();
+	auto count = builder->CreatePHI(type, 2, it.variable->name + ".count");
+	count->addIncoming(llvm::ConstantInt::get(type, 0), entry);
+	values[it.variable.get()] = at(count);
+
+	it.block->accept(*this);
+
+	// the count stays below the trip count, so counting up never wraps
+	auto latch = builder->GetInsertBlock();
+	if (latch->getTerminator() == nullptr) {
+		auto next =
+			builder->CreateNUWAdd(count, llvm::ConstantInt::get(type, 1));
+		builder->CreateCondBr(builder->CreateICmpNE(next, trip), body, done);
+		count->addIncoming(next, latch);
+		loopHints(it, latch);
+	}
+
+	builder->SetInsertPoint(done);
+}
+
 void Generator::visit(VarDecl &it) {
 	it.type->accept(*this);
 	llvm::Type *type = returned_type;
 
-	if (it.mut) {
-		auto alloca = builder->CreateAlloca(type, nullptr, it.name);
+	// already computed by ConstEval, a number is used as an immediate and
+	// an array or struct is read from .rodata
+	if (it.constant) {
+		auto value = constant(it.folded.value(), type);
+		if (type->isArrayTy() || type->isStructTy())
+			values[&it] = rodata(it, type, value,
+								 llvm::GlobalValue::PrivateLinkage);
+		else
+			values[&it] = value;
+		returned = values[&it];
+		return;
+	}
 
-		if (it.value) {
-			it.value.value()->accept(*this);
-			builder->CreateStore(returned, alloca);
-		}
+	// arrays and structs live in memory even when immutable, so an element
+	// or member can be read without loading all of them. So do references,
+	// which would otherwise look just like the `let mut` they point to
+	if (it.mut || type->isArrayTy() || type->isStructTy() ||
+		type->isPointerTy()) {
+		auto alloca = entryAlloca(type, it.name);
+		if (it.value)
+			copy(alloca, alloca->getAlign(), *it.value.value(), true);
 
-		it.llvm_value = alloca;
+		values[&it] = alloca;
 		returned = alloca;
 		return;
 	}
@@ -253,7 +1385,7 @@ void Generator::visit(VarDecl &it) {
 	llvm::Value *tmp = returned;
 
 	tmp->setName(it.name);
-	it.llvm_value = tmp;
+	values[&it] = tmp;
 	returned = tmp;
 }
 
@@ -296,23 +1428,118 @@ void Generator::visit(TypeAST &it) {
 		returned_type = llvm::Type::getInt1Ty(*context);
 		break;
 	case T::_struct:
-		returned_type = it.resolved_name->llvm_value;
+		returned_type = struct_types[it.resolved_name];
 		break;
 	case T::pointer: {
 		it.child.value()->accept(*this);
 		returned_type = llvm::PointerType::get(returned_type, 0);
 	} break;
+	case T::array: {
+		it.child.value()->accept(*this);
+		returned_type = llvm::ArrayType::get(returned_type, it.length);
+	} break;
+	case T::vector: {
+		it.child.value()->accept(*this);
+		returned_type = llvm::FixedVectorType::get(returned_type, it.length);
+	} break;
 	}
 }
+// the struct `type` holds by value, if any, whose layout has to be known first
+static StructAST *contained(const TypeAST &type) {
+	if (type.type == TypeAST::Type::_struct) return type.resolved_name;
+	if (type.type == TypeAST::Type::array)
+		return contained(*type.child.value());
+	return nullptr;
+}
+
+std::optional<uint64_t> Generator::parseAlign(const Attribute &attribute) {
+	uint64_t n;
+	if (attribute.args.size() != 1 || !attribute.args[0].key.empty() ||
+		llvm::StringRef(attribute.args[0].value).getAsInteger(10, n) ||
+		!llvm::isPowerOf2_64(n) || n > llvm::Value::MaximumAlignment)
+		return std::nullopt;
+	return n;
+}
+
 void Generator::visit(StructAST &it) {
-	std::vector<llvm::Type *> types;
+	auto s = struct_types[&it];
+	if (layouts.contains(s)) return;
+	auto &layout = layouts[s];
+	auto &data = llvm_module->getDataLayout();
 
+	bool packed = it.attribute("packed");
+	std::vector<llvm::Type *> types;
+	std::vector<llvm::Align> aligns;
 	for (auto i : it.members) {
+		if (auto inner = contained(*i->value)) inner->accept(*this);
 		i->accept(*this);
 		types.push_back(returned_type);
+
+		auto align = packed ? llvm::Align(1) : alignment(returned_type);
+		if (auto a = i->attribute("align"))
+			align = std::max(align, llvm::Align(*parseAlign(*a)));
+		aligns.push_back(align);
+	}
+
+	// members go largest alignment first, which leaves no gaps between them,
+	// with `#[hot]` ones ahead of the rest so they share the first cache
+	// line. `#[repr(C)]` and packed structs keep the order they are written
+	// in, there is no padding to take out of the latter anyway
+	std::vector<size_t> order(types.size());
+	std::iota(order.begin(), order.end(), 0);
+	if (!it.attribute("repr") && !packed) {
+		auto hot = [&](size_t i) {
+			return it.members[i]->attribute("hot") != nullptr;
+		};
+		std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+			if (hot(a) != hot(b)) return hot(a);
+			return aligns[a] > aligns[b];
+		});
 	}
+	layout.fields.resize(types.size());
 
-	it.llvm_value->setBody(types);
+	// llvm lays out the members just like C, unless the alignments were
+	// changed. Then the offsets are worked out here and the gaps filled in
+	// with padding, in a packed struct llvm leaves alone
+	bool natural = true;
+	for (size_t i = 0; i < types.size(); i++)
+		natural &= aligns[i] == data.getABITypeAlign(types[i]);
+	layout.align = llvm::Align(1);
+	for (auto align : aligns)
+		layout.align = std::max(layout.align, align);
+	if (auto a = it.attribute("align")) {
+		auto align = llvm::Align(*parseAlign(*a));
+		natural &= align <= layout.align;
+		layout.align = std::max(layout.align, align);
+	}
+
+	if (natural) {
+		std::vector<llvm::Type *> body;
+		for (auto i : order) {
+			layout.fields[i] = body.size();
+			body.push_back(types[i]);
+		}
+		s->setBody(body);
+		return;
+	}
+
+	std::vector<llvm::Type *> body;
+	uint64_t size = 0;
+	auto pad = [&](llvm::Align align) {
+		if (auto gap = llvm::offsetToAlignment(size, align)) {
+			body.push_back(llvm::ArrayType::get(builder->getInt8Ty(), gap));
+			size += gap;
+		}
+	};
+	for (auto i : order) {
+		pad(aligns[i]);
+		layout.fields[i] = body.size();
+		body.push_back(types[i]);
+		size += data.getTypeAllocSize(types[i]);
+	}
+	// an array of them keeps every one aligned
+	pad(layout.align);
+	s->setBody(body, true);
 }
 
 void Generator::visit(StructMemberAST &it) { it.value->accept(*this); }
@@ -322,6 +1549,159 @@ void Generator::visit(ExprStmt &it) {
 	return;
 }
 
+void Generator::visit(AssignStmt &it) {
+	// a struct is copied into place rather than loaded as a whole
+	auto type = it.value->checked_type;
+	if (type != nullptr && type->type == TypeAST::Type::_struct) {
+		if (auto target = address(*it.target))
+			copy(target, aligned(*it.target), *it.value, false);
+		return;
+	}
+
+	it.value->accept(*this);
+	auto value = returned;
+
+	// a lane is set by putting the whole vector back with it changed
+	auto index = dynamic_cast<IndexExprAST *>(it.target.get());
+	if (index && index->array->checked_type->isVector()) {
+		auto target = address(*index->array);
+		auto lane = offset(*index->index, index->array->checked_type->length,
+						   1, index->checked);
+		if (!value || !target || !lane) return;
+
+		auto align = aligned(*index->array);
+		index->array->checked_type->accept(*this);
+		auto vector = builder->CreateAlignedLoad(returned_type, target, align);
+		builder->CreateAlignedStore(
+			builder->CreateInsertElement(vector, value, lane), target, align);
+		return;
+	}
+
+	auto target = address(*it.target);
+	if (value && target)
+		builder->CreateAlignedStore(value, target, aligned(*it.target));
+}
+
+void Generator::builtin(CallExprAST &it) {
+	using B = CallExprAST::Builtin;
+	std::vector<llvm::Value *> args;
+	for (auto arg : it.Args) {
+		// the array of a load or store is only ever addressed, and the lanes
+		// of a shuffle are read off the literals
+		if (args.size() < 2 && it.builtin >= B::Load) {
+			args.push_back(nullptr);
+			continue;
+		}
+		if (args.size() >= 2 && it.builtin == B::Shuffle) break;
+		arg->accept(*this);
+		if (!returned) return;
+		args.push_back(returned);
+	}
+
+	// the vector the builtin makes, or stores
+	bool store = it.builtin == B::Store || it.builtin == B::MaskedStore;
+	auto &v = store ? *it.Args[2]->checked_type : *it.checked_type;
+	switch (it.builtin) {
+	case B::None:
+		return;
+	case B::Likely:
+	case B::Unlikely:
+		// a branch on the call reads the hint itself, anywhere else llvm
+		// carries it along to the branch that ends up using the value
+		returned = builder->CreateIntrinsic(
+			llvm::Intrinsic::expect, {args[0]->getType()},
+			{args[0], builder->getInt1(it.builtin == B::Likely)});
+		return;
+	case B::Splat:
+		returned = builder->CreateVectorSplat(v.length, args[0]);
+		return;
+	case B::Shuffle: {
+		std::vector<int> mask;
+		for (size_t i = 2; i < it.Args.size(); i++) {
+			auto number = static_cast<NumberExprAST *>(it.Args[i].get());
+			mask.push_back(std::stoi(number->value));
+		}
+		returned = builder->CreateShuffleVector(args[0], args[1], mask);
+		return;
+	}
+	default:
+		break;
+	}
+
+	if (it.builtin >= B::ReduceAdd && it.builtin <= B::ReduceOr) {
+		auto &e = it.Args[0]->checked_type->scalar();
+		auto type = args[0]->getType()->getScalarType();
+		switch (it.builtin) {
+		case B::ReduceAdd:
+			// -0.0 leaves every sum alone, even one of -0.0
+			returned =
+				e.isFloat()
+					? builder->CreateFAddReduce(
+						  llvm::ConstantFP::getNegativeZero(type), args[0])
+					: builder->CreateAddReduce(args[0]);
+			break;
+		case B::ReduceMul:
+			returned =
+				e.isFloat()
+					? builder->CreateFMulReduce(llvm::ConstantFP::get(type, 1),
+												args[0])
+					: builder->CreateMulReduce(args[0]);
+			break;
+		case B::ReduceMin:
+			returned = e.isFloat()
+						   ? builder->CreateFPMinReduce(args[0])
+						   : builder->CreateIntMinReduce(args[0], e.isSigned());
+			break;
+		case B::ReduceMax:
+			returned = e.isFloat()
+						   ? builder->CreateFPMaxReduce(args[0])
+						   : builder->CreateIntMaxReduce(args[0], e.isSigned());
+			break;
+		case B::ReduceAnd:
+			returned = builder->CreateAndReduce(args[0]);
+			break;
+		default:
+			returned = builder->CreateOrReduce(args[0]);
+			break;
+		}
+
+		// an ordered sum stays ordered unless the function allows
+		// reassociating it
+		if (auto inst = llvm::dyn_cast<llvm::Instruction>(returned);
+			inst && llvm::isa<llvm::FPMathOperator>(inst))
+			inst->setFastMathFlags(builder->getFastMathFlags());
+		return;
+	}
+
+	// loads and stores go through as many elements as the vector has lanes
+	auto elements = element(*it.Args[0], *it.Args[1], v.length, true);
+	if (elements == nullptr) return;
+	v.accept(*this);
+	auto type = returned_type;
+	auto align = llvm::commonAlignment(
+		aligned(*it.Args[0]),
+		llvm_module->getDataLayout().getTypeAllocSize(type->getScalarType()));
+
+	switch (it.builtin) {
+	case B::Load:
+		returned = builder->CreateAlignedLoad(type, elements, align);
+		break;
+	case B::Store:
+		returned = builder->CreateAlignedStore(args[2], elements, align);
+		break;
+	case B::MaskedLoad:
+		returned =
+			builder->CreateMaskedLoad(type, elements, align, args[2], args[3]);
+		break;
+	case B::MaskedStore:
+		returned =
+			builder->CreateMaskedStore(args[2], elements, align, args[3]);
+		break;
+	default:
+		break;
+	}
+}
+
 // template <class... Ts> struct overloads : Ts... {
 // using Ts::operator()...;
 // };
@@ -340,34 +1720,200 @@ void Generator::visit(ExprStmt &it) {
 // it.data);
 // }
 
+// whether anything in `type` is a reference, memory reached through one
+// loaded from somewhere is not memory of the arguments any more
+static bool nested(const TypeAST &type) {
+	if (type.type == TypeAST::Type::pointer) return true;
+	if (type.type == TypeAST::Type::_struct) {
+		for (auto &member : type.resolved_name->members)
+			if (nested(*member->value)) return true;
+		return false;
+	}
+	return type.child && nested(*type.child.value());
+}
+
+// what Effects found out about a function, as attributes
+static void effects(PrototypeAST &proto, const CallABI &abi, llvm::Function *f,
+					Generator &gen) {
+	// nothing ever unwinds, a failed check ends the program on the spot
+	f->setDoesNotThrow();
+
+	// structs passed in memory are arguments too, read from and written to
+	auto access = llvm::ModRefInfo::NoModRef;
+	if (proto.reads) access |= llvm::ModRefInfo::Ref;
+	if (proto.writes || abi.result.pass == CallABI::Pass::Memory)
+		access |= llvm::ModRefInfo::Mod;
+	for (auto &param : abi.params)
+		if (param.pass == CallABI::Pass::Memory)
+			access |= llvm::ModRefInfo::Ref;
+
+	bool indirect = false;
+	for (auto &param : proto.parameters) {
+		auto &type = *param->type;
+		indirect |= type.type == TypeAST::Type::pointer
+						? nested(*type.child.value())
+						: nested(type);
+	}
+	auto memory = indirect ? llvm::MemoryEffects(access)
+						   : llvm::MemoryEffects::argMemOnly(access);
+	// trapping counts as a side effect, or the check could be dropped along
+	// with a call whose result goes unused
+	if (proto.traps)
+		memory |= llvm::MemoryEffects::inaccessibleMemOnly(
+			llvm::ModRefInfo::Mod);
+	f->setMemoryEffects(memory);
+	if (!proto.traps && !proto.diverges)
+		f->addFnAttr(llvm::Attribute::WillReturn);
+
+	// references always point at something alive, whole and aligned, as
+	// TypeCheck refuses references into packed structs
+	auto &layout = gen.llvm_module->getDataLayout();
+	for (size_t i = 0; i < proto.parameters.size(); i++) {
+		auto &param = *proto.parameters[i];
+		if (param.type->type != TypeAST::Type::pointer) continue;
+
+		auto arg = abi.argument(i);
+		f->addParamAttr(arg, llvm::Attribute::NonNull);
+		param.type->child.value()->accept(gen);
+		if (auto size = layout.getTypeAllocSize(gen.returned_type))
+			f->addDereferenceableParamAttr(arg, size);
+		auto align = gen.alignment(gen.returned_type);
+		f->addParamAttr(
+			arg, llvm::Attribute::getWithAlignment(*gen.context, align));
+		if (!param.type->mut || !param.written)
+			f->addParamAttr(arg, llvm::Attribute::ReadOnly);
+		if (!param.captured) f->addParamAttr(arg, llvm::Attribute::NoCapture);
+	}
+}
+
 void breadth_function_define(FunctionAST *it, Generator &gen) {
 	std::vector<llvm::Type *> params(it->proto->parameters.size());
 
 	for (int i = 0; i < it->proto->parameters.size(); i++) {
 		auto param = it->proto->parameters[i];
-		param->accept(gen);
+		param->type->accept(gen);
 		params[i] = gen.returned_type;
 	}
 
 	it->proto->retType->accept(gen);
-	llvm::FunctionType *ft =
-		llvm::FunctionType::get(gen.returned_type, params, false);
+	auto &abi = gen.abis[it->proto.get()] =
+		CallABI::classify(*gen.llvm_module, gen.returned_type, params);
+	// llvm does not know about `#[align]`, memory a struct is passed or
+	// returned in is aligned like the struct anyway
+	auto realign = [&](CallABI::Value &value) {
+		if (value.pass == CallABI::Pass::Memory)
+			value.align = std::max(value.align, gen.alignment(value.type));
+	};
+	realign(abi.result);
+	for (auto &param : abi.params)
+		realign(param);
 	llvm::Function *f =
-		llvm::Function::Create(ft, llvm::Function::ExternalLinkage,
+		llvm::Function::Create(abi.lowered, llvm::Function::ExternalLinkage,
 							   it->proto->name, gen.llvm_module.get());
+	abi.annotate(*f);
+
+	if (abi.result.pass == CallABI::Pass::Memory) {
+		f->getArg(0)->setName("result");
+		f->addParamAttr(0, llvm::Attribute::NoAlias);
+	}
+	for (size_t i = 0; i < params.size(); i++) {
+		auto &name = it->proto->parameters[i]->name;
+		auto &param = abi.params[i];
+		if (param.pass != CallABI::Pass::Split) {
+			f->getArg(abi.argument(i))->setName(name);
+			continue;
+		}
+		for (size_t k = 0; k < param.parts.size(); k++)
+			f->getArg(abi.argument(i) + k)->setName(name + "." +
+													 std::to_string(k));
+	}
 
-	int i = 0;
-	for (auto &arg : f->args()) {
-		arg.setName(it->proto->parameters[i]->name);
-		it->proto->parameters[i++]->llvm_value = &arg;
+	// a call never gets a `&mut` together with anything else reaching the
+	// same memory, TypeCheck makes sure. The inliner keeps this around as
+	// alias scopes on the loads and stores of the inlined body
+	for (int i = 0; i < it->proto->parameters.size(); i++) {
+		auto &type = *it->proto->parameters[i]->type;
+		if (type.type == TypeAST::Type::pointer && type.mut)
+			f->addParamAttr(abi.argument(i), llvm::Attribute::NoAlias);
 	}
 
-	it->llvm_value = f;
+	// calls to a cold function make the paths leading to them cold as well,
+	// so declarations in other partitions need it too
+	if (it->proto->attribute("cold")) f->addFnAttr(llvm::Attribute::Cold);
+
+	effects(*it->proto, abi, f, gen);
+	gen.values[it] = f;
+}
+
+void breadth_const_define(VarDecl *it, Generator &gen) {
+	it->type->accept(gen);
+	auto type = gen.returned_type;
+	llvm::Constant *value = gen.constant(it->folded.value(), type);
+
+	// a number is used as an immediate, arrays and structs are read from
+	// .rodata like any other array or struct in memory. One copy is enough,
+	// so only the primary partition emits it and the others refer to it
+	if (!type->isArrayTy() && !type->isStructTy()) {
+		gen.values[it] = value;
+		return;
+	}
+
+	auto global = gen.rodata(*it, type, gen.primary ? value : nullptr,
+							 llvm::GlobalValue::ExternalLinkage);
+	global->setVisibility(llvm::GlobalValue::HiddenVisibility);
+	gen.values[it] = global;
+}
+
+llvm::Constant *Generator::constant(const ConstValue &value,
+									llvm::Type *type) {
+	if (value.isInt())
+		return llvm::ConstantInt::get(type, value.getInt().value);
+	if (value.isFloat()) return llvm::ConstantFP::get(type, value.getFloat());
+	if (value.isBool())
+		return llvm::ConstantInt::getBool(type, value.getBool());
+	if (!value.isAggregate()) return llvm::UndefValue::get(type);
+
+	auto &elements = value.getAggregate().elements;
+	if (auto s = llvm::dyn_cast<llvm::StructType>(type)) {
+		// members go where the layout put them, the padding between them
+		// is zero
+		std::vector<llvm::Constant *> members;
+		for (auto element : s->elements())
+			members.push_back(llvm::Constant::getNullValue(element));
+		auto &fields = layouts.at(s).fields;
+		for (size_t i = 0; i < elements.size(); i++)
+			members[fields[i]] =
+				constant(elements[i], s->getElementType(fields[i]));
+		return llvm::ConstantStruct::get(s, members);
+	}
+
+	auto element = llvm::isa<llvm::VectorType>(type)
+					   ? llvm::cast<llvm::VectorType>(type)->getElementType()
+					   : type->getArrayElementType();
+	std::vector<llvm::Constant *> constants;
+	for (auto &e : elements)
+		constants.push_back(constant(e, element));
+	if (llvm::isa<llvm::VectorType>(type))
+		return llvm::ConstantVector::get(constants);
+	return llvm::ConstantArray::get(llvm::cast<llvm::ArrayType>(type),
+									constants);
+}
+
+llvm::GlobalVariable *
+Generator::rodata(VarDecl &decl, llvm::Type *type, llvm::Constant *value,
+				  llvm::GlobalValue::LinkageTypes linkage) {
+	// a name of its own, so a const never takes the symbol of a function or
+	// of something in libc
+	auto global =
+		new llvm::GlobalVariable(*llvm_module, type, true, linkage, value,
+								 fmt::format("__fox_const.{}", decl.name));
+	global->setAlignment(alignment(type));
+	global->setUnnamedAddr(llvm::GlobalValue::UnnamedAddr::Global);
+	return global;
 }
 
 void breadth_struct_define(StructAST *s, Generator &gen) {
-	std::cout << "hello struct" << std::endl;
 	auto struct_ = llvm::StructType::create(*gen.context, s->name);
-	s->llvm_value = struct_;
+	gen.struct_types[s] = struct_;
 }
 } // namespace FoxLang::IR
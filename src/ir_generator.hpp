@@ -1,19 +1,216 @@
 #pragma once
 
+#include "abi.hpp"
 #include "ast_nodes.hpp"
 #include "ast_pass.hpp"
+#include "diagnostics.hpp"
 #include <llvm/IR/BasicBlock.h>
+#include <llvm/IR/IRBuilder.h>
+#include <llvm/IR/Intrinsics.h>
+#include <llvm/IR/LLVMContext.h>
+#include <llvm/IR/Module.h>
 #include <llvm/IR/Value.h>
 
+#include <functional>
+#include <map>
+#include <memory>
+#include <optional>
+#include <set>
+#include <string>
+#include <string_view>
+#include <vector>
+
 namespace FoxLang::IR {
+/// Generator - Lowers a resolved FileAST into an llvm::Module. Every
+/// generator owns its own context so several of them can run on different
+/// threads at once. Each one declares every used function, but only emits
+/// bodies for the functions it owns; calls into the rest are left as
+/// external declarations for the linker to resolve.
 class Generator : public ASTVisitor {
 public:
-	static std::unique_ptr<llvm::LLVMContext> context;
-	static std::unique_ptr<llvm::IRBuilder<>> builder;
-	static std::unique_ptr<llvm::Module> llvm_module;
+	/// What integer arithmetic does when the result does not fit its type
+	enum class Overflow {
+		// wraps around in two's complement
+		Wrap,
+		// aborts the program
+		Trap,
+		// cannot happen, lowered with nsw/nuw so llvm may assume it
+		Undefined,
+	};
+
+	/// How much floating point arithmetic may be rewritten
+	enum class FPMode {
+		// every operation rounds on its own, as IEEE 754 says
+		Strict,
+		// a multiply feeding an add may fuse into an fma
+		Contract,
+		// also reassociate, and assume there are no nans, infinities or
+		// signed zeros
+		Fast,
+	};
+
+	/// Parses the spelling used by --fp-mode and `#[fp_mode(...)]`
+	static std::optional<FPMode> parseFPMode(std::string_view name);
+
+	/// A cpu feature `#[target_clones(...)]` can make a version for
+	struct CloneTarget {
+		std::string name;
+		// bit in the features word of libgcc's __cpu_model
+		unsigned bit;
+	};
+	static const std::vector<CloneTarget> &cloneTargets();
+
+	/// One llvm.loop property a loop hint attribute stands for, like
+	/// `llvm.loop.unroll.count 4` for `#[unroll(4)]`
+	struct LoopHint {
+		LoopHint(std::string property,
+				 std::optional<uint32_t> value = std::nullopt,
+				 bool boolean = false)
+			: property(std::move(property)), value(value), boolean(boolean) {}
+
+		std::string property;
+		// operand of the property, none when the property is only a flag
+		std::optional<uint32_t> value;
+		// the operand is a bool rather than a count
+		bool boolean;
+	};
+
+	/// The properties of `#[vectorize]`, `#[unroll]` or `#[interleave]`,
+	/// nullopt when the attribute is not one of them or is malformed
+	static std::optional<std::vector<LoopHint>>
+	parseLoopHint(const Attribute &attribute);
+
+	/// The alignment `#[align(N)]` asks for, nullopt when it is malformed
+	static std::optional<uint64_t> parseAlign(const Attribute &attribute);
+
+	Generator(const std::string &name, std::set<const FunctionAST *> owned,
+			  bool primary);
+
+	std::unique_ptr<llvm::LLVMContext> context;
+	std::unique_ptr<llvm::IRBuilder<>> builder;
+	std::unique_ptr<llvm::Module> llvm_module;
 	llvm::Value *returned;
 	llvm::Type *returned_type;
 
+	// llvm values are tied to a context, so they live here rather than on the
+	// nodes which are shared between generators
+	std::map<const AST *, llvm::Value *> values;
+	std::map<const StructAST *, llvm::StructType *> struct_types;
+
+	/// Where the members of a struct are once they are reordered and its
+	/// layout attributes are applied
+	struct Layout {
+		// the element of the llvm struct each member is, in the order of
+		// StructAST::members. The elements left over are padding
+		std::vector<unsigned> fields;
+		// at least what llvm gives the struct, more under `#[align]`
+		llvm::Align align;
+	};
+	std::map<llvm::StructType *, Layout> layouts;
+	/// How each function passes structs, worked out when it is declared
+	std::map<const PrototypeAST *, CallABI> abis;
+
+	/// Functions whose bodies this generator emits
+	std::set<const FunctionAST *> owned;
+	/// Whether this generator emits the module level data, like the globals
+	/// backing consts. Exactly one generator per program should be primary
+	bool primary;
+	Overflow overflow = Overflow::Undefined;
+	/// Mode for functions without an `fp_mode` attribute
+	FPMode fp_mode = FPMode::Strict;
+	/// Whether multiversioned functions may dispatch through an ifunc, which
+	/// needs the dynamic loader to run the resolver
+	bool ifuncs = true;
+	/// Gets the errors found while lowering, which the earlier phases should
+	/// have caught already
+	Diagnostics *diagnostics = nullptr;
+
+	/// Where each loop with hints is, by its llvm.loop id, so hints llvm
+	/// could not honor can be reported at the loop
+	std::map<const llvm::MDNode *, SourceLoc> hinted_loops;
+
+	/// Set once the module is generated if lowering failed or the verifier
+	/// rejected it
+	bool broken = false;
+	std::string errors;
+
+	/// Lowers a value computed by ConstEval to a constant of the given type
+	llvm::Constant *constant(const ConstValue &value, llvm::Type *type);
+	/// A read-only global holding the value of const `decl`, only declared
+	/// when value is nullptr
+	llvm::GlobalVariable *rodata(VarDecl &decl, llvm::Type *type,
+								 llvm::Constant *value,
+								 llvm::GlobalValue::LinkageTypes linkage);
+	/// The alignment of `type` in memory, which `#[align]` can raise above
+	/// what llvm knows of
+	llvm::Align alignment(llvm::Type *type);
+	/// The element of the llvm struct for `type` that member `index` is
+	unsigned field(const TypeAST &type, size_t index);
+
+private:
+	// how the function being emitted passes its arguments and result
+	const CallABI *signature = nullptr;
+
+	void error(AST &node, std::string message, std::string code);
+	void fallthrough(llvm::BasicBlock *from, llvm::BasicBlock *to);
+	llvm::AllocaInst *entryAlloca(llvm::Type *type, const std::string &name);
+	void trapIf(llvm::Value *condition);
+	/// Lowers the condition of a branch, looking through likely() and
+	/// unlikely() to set `expect` to the outcome they name
+	llvm::Value *branchCondition(ExprAST &condition,
+								 std::optional<bool> &expect);
+	/// Branch weights favoring `expect`, nullptr when nothing is expected
+	llvm::MDNode *branchWeights(std::optional<bool> expect);
+	/// Puts the hints on `loop` onto the branch that jumps back to its
+	/// header, if any
+	void loopHints(const AST &loop, llvm::BasicBlock *latch);
+	/// Emits the body of a `for` counting from zero up to `trip` from the
+	/// current block, with `at` giving the loop variable for each count
+	void emitFor(ForStmt &it, llvm::BasicBlock *done, llvm::Value *trip,
+				 const std::function<llvm::Value *(llvm::Value *)> &at);
+	llvm::FastMathFlags fastMath(const PrototypeAST &proto);
+	/// The type `variable` holds when it is memory rather than the value
+	/// itself, like the alloca of a `let mut`, a `byval` argument or the
+	/// global of a const array
+	llvm::Type *stored(llvm::Value *variable);
+	/// Where the value of `expr` already is in memory, nullptr when it is
+	/// not anywhere
+	llvm::Value *placed(ExprAST &expr);
+	/// Where the value of `expr` lives in memory, for assigning to it or
+	/// indexing into it. Values not in memory yet get a temporary
+	llvm::Value *address(ExprAST &expr);
+	/// The alignment the memory of `place` is known to have, which is less
+	/// than that of its type inside a packed struct
+	llvm::Align aligned(ExprAST &place);
+	/// Puts the value of `value` into the memory at `into`, aligned to
+	/// `align`, structs member by member or with one memcpy rather than as a
+	/// whole. `fresh` is whether nothing else can see `into` yet, so a call
+	/// can return straight into it
+	void copy(llvm::Value *into, llvm::Align align, ExprAST &value,
+			  bool fresh);
+	/// Emits a call to a function, returning its result or, when the
+	/// result is a struct passed in memory or registers, where it was put.
+	/// That is `into` when it is given
+	llvm::Value *call(CallExprAST &it, llvm::Value *into);
+	/// `index` as an i64, after checking that `count` elements starting at
+	/// it fit in `length` when `checked` is set
+	llvm::Value *offset(ExprAST &index, uint64_t length, uint64_t count,
+						bool checked);
+	/// Where element `index` of `array` is, with room for `count` of them
+	llvm::Value *element(ExprAST &array, ExprAST &index, uint64_t count,
+						 bool checked);
+	void builtin(CallExprAST &it);
+	void body(FunctionAST &it, llvm::Function *func);
+	void multiversion(FunctionAST &it, llvm::Function *func,
+					  const Attribute &clones);
+	void dispatch(llvm::Function *func, llvm::Function *resolver);
+	llvm::Value *arithmetic(llvm::Instruction::BinaryOps op,
+							llvm::Intrinsic::ID checked, llvm::Value *left,
+							llvm::Value *right, bool is_signed);
+	/// `&&` and `||`, which only evaluate their right side when the left
+	/// one does not settle the result
+	void logical(BinaryExprAST &it);
+
 public:
 	virtual void visit(BlockAST &it);
 	virtual void visit(BinaryExprAST &it);
@@ -22,15 +219,23 @@ public:
 	virtual void visit(StringLiteralAST &it);
 	virtual void visit(BoolLiteralAST &it);
 	virtual void visit(StructLiteralAST &it);
+	virtual void visit(ArrayLiteralAST &it);
 	virtual void visit(VariableExprAST &it);
+	virtual void visit(IndexExprAST &it);
+	virtual void visit(RefExprAST &it);
+	virtual void visit(DerefExprAST &it);
+	virtual void visit(StructMemberAccessAST &it);
+	virtual void visit(LayoutExprAST &it);
 	virtual void visit(FileAST &it);
 	virtual void visit(ParameterAST &it);
 	virtual void visit(FunctionAST &it);
 	virtual void visit(PrototypeAST &it);
 	virtual void visit(ExprStmt &it);
+	virtual void visit(AssignStmt &it);
 	virtual void visit(ReturnStmt &it);
 	virtual void visit(IfStmt &it);
 	virtual void visit(WhileStmt &it);
+	virtual void visit(ForStmt &it);
 	virtual void visit(VarDecl &it);
 	virtual void visit(TypeAST &it);
 	virtual void visit(StructAST &it);
@@ -0,0 +1,77 @@
+#include "jit.hpp"
+
+#include <llvm/ExecutionEngine/Orc/CompileOnDemandLayer.h>
+#include <llvm/ExecutionEngine/Orc/ExecutionUtils.h>
+#include <llvm/ExecutionEngine/Orc/LLJIT.h>
+#include <llvm/ExecutionEngine/Orc/TargetProcess/TargetExecutionUtils.h>
+#include <llvm/Support/TargetSelect.h>
+
+#include <mutex>
+
+#if defined(__x86_64__) || defined(__i386__)
+// the cpu model multiversioned functions dispatch on lives in libgcc or
+// compiler-rt, which do not export it to dlsym, so the jit is given the copy
+// linked into the compiler
+extern "C" void __cpu_indicator_init();
+extern "C" unsigned __cpu_model[4];
+#endif
+
+namespace FoxLang {
+std::optional<std::string> JIT::run(IR::Generator &ir,
+									const std::string &program,
+									const std::vector<std::string> &args,
+									int &status) {
+	static std::once_flag initialized;
+	std::call_once(initialized, [] {
+		llvm::InitializeNativeTarget();
+		llvm::InitializeNativeTargetAsmPrinter();
+		llvm::InitializeNativeTargetAsmParser();
+	});
+
+	auto jit = llvm::orc::LLLazyJITBuilder().create();
+	if (!jit) return llvm::toString(jit.takeError());
+
+	// only what was asked for is compiled, the rest of the module stays
+	// behind a stub until something calls into it
+	(*jit)->getCompileOnDemandLayer().setPartitionFunction(
+		llvm::orc::CompileOnDemandLayer::compileRequested);
+
+	// let programs reach the C library and anything else already loaded
+	auto &dl = (*jit)->getDataLayout();
+	auto process =
+		llvm::orc::DynamicLibrarySearchGenerator::GetForCurrentProcess(
+			dl.getGlobalPrefix());
+	if (!process) return llvm::toString(process.takeError());
+	(*jit)->getMainJITDylib().addGenerator(std::move(*process));
+
+#if defined(__x86_64__) || defined(__i386__)
+	llvm::orc::SymbolMap cpu;
+	auto add = [&](const char *name, const void *address) {
+		cpu[(*jit)->mangleAndIntern(name)] = {
+			llvm::orc::ExecutorAddr::fromPtr(address),
+			llvm::JITSymbolFlags::Exported};
+	};
+	add("__cpu_indicator_init",
+		reinterpret_cast<const void *>(&__cpu_indicator_init));
+	add("__cpu_model", &__cpu_model);
+	if (auto err = (*jit)->getMainJITDylib().define(
+			llvm::orc::absoluteSymbols(std::move(cpu))))
+		return llvm::toString(std::move(err));
+#endif
+
+	// the builder points into the context, which the jit takes over
+	ir.builder.reset();
+	ir.llvm_module->setDataLayout(dl);
+	llvm::orc::ThreadSafeModule module(std::move(ir.llvm_module),
+									   std::move(ir.context));
+	if (auto err = (*jit)->addLazyIRModule(std::move(module)))
+		return llvm::toString(std::move(err));
+
+	auto main = (*jit)->lookup("main");
+	if (!main) return llvm::toString(main.takeError());
+
+	status = llvm::orc::runAsMain(main->toPtr<int (*)(int, char *[])>(), args,
+								  llvm::StringRef(program));
+	return std::nullopt;
+}
+} // namespace FoxLang
@@ -0,0 +1,23 @@
+#pragma once
+
+#include "ir_generator.hpp"
+
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace FoxLang {
+/// JIT - Runs a program in process with ORC. Functions are compiled lazily,
+/// one at a time the first time they are called, so a short run only pays
+/// for the code it actually reaches.
+class JIT {
+public:
+	/// Calls `main` in the module of `ir`, which is consumed, with `args` as
+	/// its arguments and stores what it returned in `status`. Returns why the
+	/// program could not be run, if it could not
+	static std::optional<std::string> run(IR::Generator &ir,
+										  const std::string &program,
+										  const std::vector<std::string> &args,
+										  int &status);
+};
+} // namespace FoxLang
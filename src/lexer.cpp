@@ -2,13 +2,13 @@
 
 namespace FoxLang {
 std::vector<Token> *Lexer::Lex() {
-	while (!AtEnd()) {
+	while (!AtEnd() && !diagnostics.shouldAbort()) {
 		start = current;
 		currentToken();
 	}
 
 	tokens.push_back(
-		Token(TokenType::EOF_TOKEN, "", line, column, current, fp));
+		Token(TokenType::EOF_TOKEN, "", SourceLoc::get(file, current)));
 	return &tokens;
 }
 
@@ -39,7 +39,7 @@ void Lexer::currentToken() {
 		addToken(TokenType::COMMA);
 		break;
 	case '.':
-		addToken(TokenType::DOT);
+		addToken(match('.') ? TokenType::DOT_DOT : TokenType::DOT);
 		break;
 	case '-':
 		addToken(TokenType::MINUS);
@@ -69,10 +69,23 @@ void Lexer::currentToken() {
 		addToken(match('=') ? TokenType::EQUAL_EQUAL : TokenType::EQUAL);
 		break;
 	case '<':
-		addToken(match('=') ? TokenType::LESS_EQUAL : TokenType::LESS);
+		if (match('<'))
+			addToken(TokenType::LEFT_SHIFT);
+		else
+			addToken(match('=') ? TokenType::LESS_EQUAL : TokenType::LESS);
 		break;
 	case '>':
-		addToken(match('=') ? TokenType::GREATER_EQUAL : TokenType::GREATER);
+		if (match('>'))
+			addToken(TokenType::RIGHT_SHIFT);
+		else
+			addToken(match('=') ? TokenType::GREATER_EQUAL
+								: TokenType::GREATER);
+		break;
+	case '%':
+		addToken(TokenType::PERCENT);
+		break;
+	case '#':
+		addToken(TokenType::HASH);
 		break;
 	case '/':
 		if (match('/')) {
@@ -100,8 +113,6 @@ void Lexer::currentToken() {
 		identifier();
 	} break;
 	case '\n':
-		line++;
-		column = 1;
 		break;
 	case '"':
 		string();
@@ -112,16 +123,13 @@ void Lexer::currentToken() {
 		else if (isAlpha(c))
 			identifier();
 		else
-			messages.push_back(
+			diagnostics.report(
 				Message{.message = fmt::format("Unexpected character {}", c),
 						.level = Severity::Error,
 						.code = "E0001",
 						.span = Location{
-							.fp = fp,
-							.line = line,
-							.column = column,
-							.start = current,
-							.end = current + 1,
+							.loc = SourceLoc::get(file, current - 1),
+							.length = 1,
 						}});
 	} break;
 	}
@@ -174,13 +182,12 @@ char Lexer::peekBack(int n) { return source->at(current - n); }
 char Lexer::advance() {
 	char c = source->at(current);
 	current++;
-	column++;
 	return c;
 }
 
 void Lexer::addToken(TokenType token) {
 	std::string substr = source->substr(start, current - start);
-	tokens.push_back(Token(token, substr, line, column, current, fp));
+	tokens.push_back(Token(token, substr, SourceLoc::get(file, start)));
 }
 
 bool Lexer::match(char expected) {
@@ -197,25 +204,17 @@ char Lexer::peekNext() {
 }
 
 void Lexer::string() {
-	while (peek() != '"' && !AtEnd()) {
-		if (peek() == '\n') {
-			line++;
-			column = 1;
-		}
+	while (peek() != '"' && !AtEnd())
 		advance();
-	}
 
 	if (AtEnd()) {
-		messages.push_back(
+		diagnostics.report(
 			Message{.message = fmt::format("Unterminated string"),
 					.level = Severity::Error,
 					.code = "E0002",
 					.span = Location{
-						.fp = fp,
-						.line = line,
-						.column = column,
-						.start = current,
-						.end = current + 1,
+						.loc = SourceLoc::get(file, start),
+						.length = 1,
 					}});
 		return;
 	}
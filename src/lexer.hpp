@@ -1,18 +1,17 @@
 #pragma once
 
-#include <deque>
 #include <fmt/format.h>
 #include <string>
 #include <vector>
 
-#include "message.hpp"
+#include "diagnostics.hpp"
 #include "tokens.hpp"
 
 namespace FoxLang {
 class Lexer {
 public:
-	Lexer(std::string *source, std::string fp, std::deque<Message> &messages)
-		: source(source), fp(fp), messages(messages) {}
+	Lexer(const std::string *source, uint32_t file, Diagnostics &diagnostics)
+		: source(source), file(file), diagnostics(diagnostics) {}
 
 	std::vector<Token> *Lex();
 
@@ -36,24 +35,23 @@ private:
 	void identifier();
 
 private:
-	std::string *source;
-	std::string fp;
+	const std::string *source;
+	uint32_t file;
 	std::vector<Token> tokens;
-	std::deque<Message> messages;
+	Diagnostics &diagnostics;
 	unsigned long int current = 0;
 	unsigned long int start = 0;
-	unsigned long line = 1;
-	unsigned long column = 1;
 
 	// clang-format off
 	struct {
 		std::string name;
 		TokenType value;
-	} keywords[14] = {
+	} keywords[15] = {
 		{.name = "struct",	.value = TokenType::STRUCT},
 		{.name = "else",	.value = TokenType::ELSE},
 		{.name = "false",	.value = TokenType::FALSE},
 		{.name = "for",		.value = TokenType::FOR},
+		{.name = "in",		.value = TokenType::IN},
 		{.name = "fn",		.value = TokenType::FUNC},
 		{.name = "if",		.value = TokenType::IF},
 		{.name = "return",	.value = TokenType::RETURN},
@@ -1,6 +1,9 @@
-#include <deque>
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
 #include <fstream>
 #include <iostream>
+#include <numeric>
 #include <llvm/IR/BasicBlock.h>
 #include <llvm/IR/IRBuilder.h>
 #include <string>
@@ -9,26 +12,93 @@
 
 #include "ast_nodes.hpp"
 #include "ast_parser.hpp"
+#include "bounds_check.hpp"
+#include "codegen.hpp"
+#include "const_eval.hpp"
+#include "diagnostics.hpp"
+#include "effects.hpp"
+#include "emitter.hpp"
 #include "ir_generator.hpp"
+#include "jit.hpp"
 #include "lexer.hpp"
 
 #include "message.hpp"
 #include "name_resolution.hpp"
+#include "source_manager.hpp"
+#include "tree_shaking.hpp"
+#include "type_check.hpp"
 
 void printTree(const std::string &prefix, const FoxLang::AST *node,
 			   bool isLeft);
 void printTree(const FoxLang::AST *node);
-void handle_messages(std::deque<FoxLang::Message> &messages);
+void handle_messages(FoxLang::Diagnostics &diagnostics,
+					 FoxLang::MessagePrinter &printer);
+void add_frontend_arguments(argparse::ArgumentParser &command);
+void add_optimizer_arguments(argparse::ArgumentParser &command);
+FoxLang::IR::Generator::Overflow
+overflow_policy(argparse::ArgumentParser &command);
+int compile(argparse::ArgumentParser &command);
+int run(argparse::ArgumentParser &command);
 
 auto main(int argc, char *argv[]) -> int {
 	argparse::ArgumentParser program("fox", "0.0.1 epsilon");
 
 	argparse::ArgumentParser compile_command("compile");
-	compile_command.add_argument("--print-ast").flag();
-	compile_command.add_argument("-o", "--output").nargs(1);
+	add_frontend_arguments(compile_command);
+	add_optimizer_arguments(compile_command);
+	compile_command.add_argument("-o", "--output")
+		.help("where to write the output, - for stdout")
+		.nargs(1);
+	compile_command.add_argument("--emit")
+		.help("what to write to the output")
+		.default_value(std::string("obj"))
+		.choices("obj", "asm", "bc", "llvm-ir");
+	compile_command.add_argument("--dump-ir")
+		.help("print the optimized IR of every partition to stderr")
+		.flag();
+	compile_command.add_argument("--codegen-units")
+		.help("number of modules to split the program into, 0 for one per "
+			  "function")
+		.default_value(0u)
+		.scan<'u', unsigned>();
+	compile_command.add_argument("-j", "--jobs")
+		.help("threads to generate code on, 0 for one per core")
+		.default_value(0u)
+		.scan<'u', unsigned>();
+	compile_command.add_argument("--cache-dir")
+		.help("reuse objects of unchanged partitions from this directory, "
+			  "defaults to $FOX_CACHE_DIR, not used with --dump-ir or "
+			  "--time-passes");
+	compile_command.add_argument("--cache-size")
+		.help("most bytes the cache directory may hold")
+		.default_value(uint64_t(1024 * 1024 * 1024))
+		.scan<'u', uint64_t>();
+	compile_command.add_argument("--cache-stats")
+		.help("report cache hits, misses and evictions")
+		.flag();
+	compile_command.add_argument("--target")
+		.help("triple to generate code for, defaults to the host's");
+	compile_command.add_argument("--cpu")
+		.help("cpu to generate code for, native for the one this runs on")
+		.default_value(std::string("generic"));
+	compile_command.add_argument("--features")
+		.help("cpu features to turn on or off, like +avx2,-fma")
+		.default_value(std::string(""));
 	compile_command.add_argument("files").required().nargs(1);
 
+	argparse::ArgumentParser run_command("run");
+	run_command.add_description(
+		"compile a program in memory and run it, compiling functions the "
+		"first time they are called");
+	add_frontend_arguments(run_command);
+	add_optimizer_arguments(run_command);
+	run_command.add_argument("files").required().nargs(1);
+	run_command.add_argument("args")
+		.help("arguments passed on to the program")
+		.remaining();
+
 	program.add_subparser(compile_command);
+	program.add_subparser(run_command);
 
 	try {
 		program.parse_args(argc, argv);
@@ -38,49 +108,470 @@ auto main(int argc, char *argv[]) -> int {
 		std::exit(1);
 	}
 
-	auto file_name = compile_command.get<std::string>("files");
+	if (program.is_subcommand_used(run_command)) return run(run_command);
+	if (program.is_subcommand_used(compile_command))
+		return compile(compile_command);
+
+	std::cerr << program;
+	return 1;
+}
+
+void add_frontend_arguments(argparse::ArgumentParser &command) {
+	command.add_argument("--print-ast").flag();
+	command.add_argument("--error-limit")
+		.help("stop after this many errors, 0 for no limit")
+		.default_value(20u)
+		.scan<'u', unsigned>();
+	command.add_argument("--diagnostics-format")
+		.help("text for people, json for one object per line")
+		.default_value(std::string("text"))
+		.choices("text", "json");
+	command.add_argument("--const-eval-steps")
+		.help("most steps compile-time evaluation may take")
+		.default_value(uint64_t(10'000'000))
+		.scan<'u', uint64_t>();
+	command.add_argument("--const-eval-memory")
+		.help("most bytes compile-time evaluation may hold at once")
+		.default_value(size_t(64 * 1024 * 1024))
+		.scan<'u', size_t>();
+	command.add_argument("--export")
+		.help("keep this function even if main never reaches it")
+		.default_value(std::vector<std::string>{})
+		.append();
+	command.add_argument("--print-bounds-checks")
+		.help("list the array indexing that still needs a check at runtime")
+		.flag();
+	command.add_argument("--no-tree-shake")
+		.help("generate code for every function, reachable or not")
+		.flag();
+	command.add_argument("--print-skipped")
+		.help("list the functions and structs tree shaking left out")
+		.flag();
+	command.add_argument("--print-struct-layouts")
+		.help("show the size, padding and member offsets of every struct")
+		.flag();
+}
+
+void add_optimizer_arguments(argparse::ArgumentParser &command) {
+	auto &opt_level = command.add_mutually_exclusive_group();
+	opt_level.add_argument("-O0").help("no optimization (default)").flag();
+	opt_level.add_argument("-O1").help("optimize quickly").flag();
+	opt_level.add_argument("-O2").help("optimize").flag();
+	opt_level.add_argument("-O3").help("optimize aggressively").flag();
+	opt_level.add_argument("-Os").help("optimize for size").flag();
+	command.add_argument("--passes")
+		.help("run this pass pipeline, in opt syntax, instead of the -O one");
+	command.add_argument("--time-passes")
+		.help("report the time spent in each optimization pass")
+		.flag();
+	command.add_argument("--overflow")
+		.help("what integer overflow does: wrap around, trap, or undefined "
+			  "so the optimizer may assume it never happens")
+		.default_value(std::string("undefined"))
+		.choices("wrap", "trap", "undefined");
+	command.add_argument("--fp-mode")
+		.help("how freely floating point math may be rewritten, functions "
+			  "can pick their own with #[fp_mode(\"...\")]")
+		.default_value(std::string("strict"))
+		.choices("strict", "contract", "fast");
+}
+
+FoxLang::MessagePrinter::Format
+message_format(argparse::ArgumentParser &command) {
+	return command.get<std::string>("--diagnostics-format") == "json"
+			   ? FoxLang::MessagePrinter::Format::Json
+			   : FoxLang::MessagePrinter::Format::Text;
+}
+
+FoxLang::FileAST *frontend(argparse::ArgumentParser &command,
+						   FoxLang::SourceManager &sm) {
+	auto file_name = command.get<std::string>("files");
 	std::ifstream file(file_name);
 
 	if (!file.is_open()) {
 		std::cerr << "Could not open file `" << file_name << "`" << std::endl;
-		std::exit(1);
+		return nullptr;
 	}
 
-	std::deque<FoxLang::Message> messages;
+	FoxLang::Diagnostics diagnostics(command.get<unsigned>("--error-limit"));
+	FoxLang::MessagePrinter printer(sm, message_format(command));
 
 	std::string contents((std::istreambuf_iterator<char>(file)),
 						 (std::istreambuf_iterator<char>()));
 
-	FoxLang::Lexer lexer(&contents, file_name, messages);
+	uint32_t file_id = sm.addFile(file_name, std::move(contents));
+	if (file_id == 0) {
+		std::cerr << "File `" << file_name << "` is too large to compile"
+				  << std::endl;
+		return nullptr;
+	}
+
+	FoxLang::Lexer lexer(&sm.getBuffer(file_id), file_id, diagnostics);
 	std::vector<FoxLang::Token> *tokens = lexer.Lex();
+	handle_messages(diagnostics, printer);
 
-	FoxLang::Parser ast(tokens, messages);
+	FoxLang::Parser ast(tokens, diagnostics);
 	auto tree = ast.parse();
+	handle_messages(diagnostics, printer);
+
+	if (!diagnostics.shouldAbort()) {
+		FoxLang::NameResolution nr(diagnostics);
+		tree->accept(nr);
+		handle_messages(diagnostics, printer);
+	}
+
+	if (!diagnostics.hasErrors()) {
+		FoxLang::TypeCheck tc(diagnostics);
+		tree->accept(tc);
+		handle_messages(diagnostics, printer);
+	}
+
+	if (!diagnostics.hasErrors()) {
+		FoxLang::ConstEval::Limits limits;
+		limits.steps = command.get<uint64_t>("--const-eval-steps");
+		limits.memory = command.get<size_t>("--const-eval-memory");
+
+		FoxLang::ConstEval eval(diagnostics, limits);
+		tree->accept(eval);
+		handle_messages(diagnostics, printer);
+	}
+
+	if (diagnostics.shouldAbort())
+		std::cerr << "Aborting after " << diagnostics.errorCount()
+				  << " errors" << std::endl;
+	if (diagnostics.hasErrors()) return nullptr;
+
+	FoxLang::BoundsCheck bounds(overflow_policy(command) ==
+								FoxLang::IR::Generator::Overflow::Wrap);
+	tree->accept(bounds);
+	if (command["--print-bounds-checks"] == true) {
+		for (auto index : bounds.kept) {
+			auto loc = sm.expand(index->loc);
+			fmt::print(stderr, "bounds check kept ({}:{}:{})\n", loc.fp,
+					   loc.line, loc.column);
+		}
+	}
+
+	auto overflow = overflow_policy(command);
+	FoxLang::Effects effects(
+		overflow == FoxLang::IR::Generator::Overflow::Trap,
+		overflow != FoxLang::IR::Generator::Overflow::Undefined);
+	tree->accept(effects);
+
+	if (command["print-ast"] == true) printTree(tree);
+
+	if (command["--no-tree-shake"] == false) {
+		auto exports = command.get<std::vector<std::string>>("--export");
+		FoxLang::TreeShaker shaker(
+			std::set<std::string>(exports.begin(), exports.end()));
+		tree->accept(shaker);
+
+		if (command["--print-skipped"] == true) {
+			for (auto node : shaker.skipped) {
+				auto loc = sm.expand(node->loc);
+				if (auto f = dynamic_cast<FoxLang::FunctionAST *>(node))
+					fmt::print(stderr, "skipped function `{}` ({}:{}:{})\n",
+							   f->proto->name, loc.fp, loc.line, loc.column);
+				else if (auto st = dynamic_cast<FoxLang::StructAST *>(node))
+					fmt::print(stderr, "skipped struct `{}` ({}:{}:{})\n",
+							   st->name, loc.fp, loc.line, loc.column);
+			}
+		}
+	}
+
+	return tree;
+}
+
+bool optimizer_options(argparse::ArgumentParser &command,
+					   FoxLang::Optimizer::Options &options) {
+	if (command["-O1"] == true)
+		options.level = FoxLang::Optimizer::Level::O1;
+	else if (command["-O2"] == true)
+		options.level = FoxLang::Optimizer::Level::O2;
+	else if (command["-O3"] == true)
+		options.level = FoxLang::Optimizer::Level::O3;
+	else if (command["-Os"] == true)
+		options.level = FoxLang::Optimizer::Level::Os;
+	options.time_passes = command["--time-passes"] == true;
+	if (auto passes = command.present("--passes")) {
+		if (auto err = FoxLang::Optimizer::validate(*passes)) {
+			std::cerr << "Invalid pass pipeline: " << *err << std::endl;
+			return false;
+		}
+		options.passes = *passes;
+	}
+	return true;
+}
+
+FoxLang::IR::Generator::Overflow
+overflow_policy(argparse::ArgumentParser &command) {
+	auto policy = command.get<std::string>("--overflow");
+	if (policy == "wrap") return FoxLang::IR::Generator::Overflow::Wrap;
+	if (policy == "trap") return FoxLang::IR::Generator::Overflow::Trap;
+	return FoxLang::IR::Generator::Overflow::Undefined;
+}
+
+FoxLang::IR::Generator::FPMode fp_mode(argparse::ArgumentParser &command) {
+	auto mode = command.get<std::string>("--fp-mode");
+	return FoxLang::IR::Generator::parseFPMode(mode).value_or(
+		FoxLang::IR::Generator::FPMode::Strict);
+}
+
+void print_timings(const std::vector<FoxLang::Optimizer::Timing> &timings) {
+	std::chrono::nanoseconds total{};
+	for (auto &t : timings)
+		total += t.time;
+
+	fmt::print(stderr, "{:>10}  {:>6}  {:>5}  {}\n", "time (ms)", "%", "runs",
+			   "pass");
+	for (auto &t : timings)
+		fmt::print(stderr, "{:>10.3f}  {:>6.2f}  {:>5}  {}\n",
+				   t.time.count() / 1e6,
+				   total.count() ? 100.0 * t.time / total : 0.0, t.runs,
+				   t.pass);
+	fmt::print(stderr, "{:>10.3f}  {:>6.2f}  {:>5}  total\n",
+			   total.count() / 1e6, 100.0, "");
+}
+
+void print_struct_layouts(const FoxLang::FileAST &tree,
+						  const std::vector<FoxLang::Partition> &partitions,
+						  FoxLang::SourceManager &sm) {
+	for (auto &node : tree.expressions) {
+		auto s = dynamic_cast<FoxLang::StructAST *>(node.get());
+		if (s == nullptr) continue;
+
+		// every partition lays out the structs it uses the same way, take
+		// whichever lowered this one first
+		auto lowered = std::find_if(
+			partitions.begin(), partitions.end(),
+			[&](auto &p) { return p.ir->struct_types.contains(s); });
+		if (lowered == partitions.end()) continue;
+		auto &ir = *lowered->ir;
+		auto &data = ir.llvm_module->getDataLayout();
+		auto type = ir.struct_types.at(s);
+		auto &layout = ir.layouts.at(type);
+		auto offsets = data.getStructLayout(type);
+
+		// members in the order they ended up in, the gaps between them are
+		// padding
+		std::vector<size_t> order(s->members.size());
+		std::iota(order.begin(), order.end(), 0);
+		std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+			return layout.fields[a] < layout.fields[b];
+		});
+		uint64_t size = offsets->getSizeInBytes(), used = 0;
+		for (auto i : order)
+			used += data.getTypeAllocSize(
+				type->getElementType(layout.fields[i]));
+
+		auto loc = sm.expand(s->loc);
+		bool reordered = !std::is_sorted(order.begin(), order.end());
+		fmt::print(stderr,
+				   "struct `{}` ({}:{}:{}): {} bytes, align {}, {} bytes of "
+				   "padding{}\n",
+				   s->name, loc.fp, loc.line, loc.column, size,
+				   layout.align.value(), size - used,
+				   reordered ? ", reordered" : "");
+
+		uint64_t end = 0;
+		for (auto i : order) {
+			auto &member = *s->members[i];
+			auto element = layout.fields[i];
+			uint64_t offset = offsets->getElementOffset(element);
+			if (offset > end)
+				fmt::print(stderr, "  {:>6}  padding, {} bytes\n", end,
+						   offset - end);
+
+			end = offset + data.getTypeAllocSize(type->getElementType(element));
+			std::string hot;
+			if (member.attribute("hot"))
+				hot = end > 64 ? ", hot past the first cache line" : ", hot";
+			fmt::print(stderr, "  {:>6}  {} {}, {} bytes{}\n", offset,
+					   member.name, member.value->spelling(), end - offset,
+					   hot);
+		}
+		if (size > end)
+			fmt::print(stderr, "  {:>6}  padding, {} bytes\n", end, size - end);
+	}
+}
+
+int compile(argparse::ArgumentParser &command) {
+	FoxLang::SourceManager sm;
+	auto tree = frontend(command, sm);
+	if (tree == nullptr) return 1;
+
+	auto file_name = command.get<std::string>("files");
+
+	FoxLang::CodeGen::Options options;
+	options.name = file_name;
+	options.units = command.get<unsigned>("--codegen-units");
+	options.jobs = command.get<unsigned>("--jobs");
+	if (!optimizer_options(command, options.optimize)) return 1;
+	options.overflow = overflow_policy(command);
+	options.fp_mode = fp_mode(command);
+
+	auto emit = command.get<std::string>("--emit");
+	auto kind = FoxLang::Emitter::Kind::Object;
+	if (emit == "asm")
+		kind = FoxLang::Emitter::Kind::Assembly;
+	else if (emit == "bc")
+		kind = FoxLang::Emitter::Kind::Bitcode;
+	else if (emit == "llvm-ir")
+		kind = FoxLang::Emitter::Kind::LLVMIR;
+	options.objects = kind == FoxLang::Emitter::Kind::Object;
+
+	std::string output;
+	if (auto o = command.present("--output")) {
+		output = *o;
+	} else {
+		auto stem = std::filesystem::path(file_name).filename();
+		stem.replace_extension(FoxLang::Emitter::extension(kind));
+		output = stem.string();
+	}
+
+	std::string error;
+	auto target = FoxLang::Target::create(
+		command.present("--target").value_or(""),
+		command.get<std::string>("--cpu"),
+		command.get<std::string>("--features"), error);
+	if (target == nullptr) {
+		std::cerr << "Could not find a target: " << error << std::endl;
+		return 1;
+	}
+
+	// a single object needs no linking, several are only compiled apart
+	// when the host can put them back together
+	if (options.units != 1 && !FoxLang::Emitter::combines(*target))
+		options.objects = false;
+
+	std::string cache_dir;
+	if (auto dir = command.present("--cache-dir"))
+		cache_dir = *dir;
+	else if (auto dir = std::getenv("FOX_CACHE_DIR"))
+		cache_dir = dir;
+
+	// a cached object was never optimized, so there is no ir or pass
+	// timings to show for it
+	bool inspecting =
+		command["--dump-ir"] == true || options.optimize.time_passes;
+	std::unique_ptr<FoxLang::ObjectCache> cache;
+	if (!cache_dir.empty() && options.objects && !inspecting) {
+		cache = std::make_unique<FoxLang::ObjectCache>(
+			cache_dir, command.get<uint64_t>("--cache-size"));
+		options.cache = cache.get();
+	}
+
+	// what lowering and the optimizer find, the frontend already reported
+	// its own
+	FoxLang::Diagnostics diagnostics;
+	options.diagnostics = &diagnostics;
+
+	FoxLang::CodeGen codegen(options, *target);
+	auto partitions = codegen.run(*tree);
 
-	FoxLang::NameResolution nr(messages);
-	tree->accept(nr);
+	FoxLang::MessagePrinter printer(sm, message_format(command));
+	handle_messages(diagnostics, printer);
+	if (command["--print-struct-layouts"] == true)
+		print_struct_layouts(*tree, partitions, sm);
 
-	// bool erred = false;
-	handle_messages(messages);
-	for (auto i : messages) {
-		if (i.level == FoxLang::Severity::Error) {
-			return 1;
+	if (cache != nullptr) {
+		cache->prune();
+		if (command["--cache-stats"] == true)
+			fmt::print(stderr,
+					   "cache: {} hits, {} misses, {} stored, {} evicted "
+					   "({} bytes), {} bytes in use\n",
+					   cache->stats.hits.load(), cache->stats.misses.load(),
+					   cache->stats.stored.load(), cache->stats.evicted,
+					   cache->stats.evicted_bytes, cache->stats.size);
+	}
+
+	bool broken = false;
+	for (auto &partition : partitions) {
+		if (partition.ir->broken) {
+			std::cerr << partition.ir->errors;
+			broken = true;
 		}
+		if (command["--dump-ir"] == true)
+			partition.ir->llvm_module->print(llvm::errs(), nullptr);
 	}
 
-	if (compile_command["print-ast"] == true) printTree(tree);
+	if (options.optimize.time_passes) print_timings(codegen.timings);
 
-	FoxLang::IR::Generator ir;
-	tree->accept(ir);
+	if (broken) return 1;
+
+	FoxLang::Emitter emitter(kind, *target, options.optimize.level);
+	if (auto err = emitter.write(partitions, output)) {
+		std::cerr << "Could not write `" << output << "`: " << *err
+				  << std::endl;
+		return 1;
+	}
 
 	return 0;
 }
 
-void handle_messages(std::deque<FoxLang::Message> &messages) {
-	while (!messages.empty()) {
-		messages.front().print();
-		messages.pop_front();
+int run(argparse::ArgumentParser &command) {
+	FoxLang::SourceManager sm;
+	auto tree = frontend(command, sm);
+	if (tree == nullptr) return 1;
+
+	auto file_name = command.get<std::string>("files");
+
+	// one module on this thread, the jit splits it up per function itself
+	FoxLang::CodeGen::Options options;
+	options.name = file_name;
+	options.units = 1;
+	options.jobs = 1;
+	options.ifuncs = false;
+	if (!optimizer_options(command, options.optimize)) return 1;
+	options.overflow = overflow_policy(command);
+	options.fp_mode = fp_mode(command);
+
+	// the code only ever runs here, so it may use everything this cpu has
+	std::string error;
+	auto target = FoxLang::Target::create("", "native", "", error);
+	if (target == nullptr) {
+		std::cerr << "Could not find a target: " << error << std::endl;
+		return 1;
 	}
+
+	// what lowering and the optimizer find, the frontend already reported
+	// its own
+	FoxLang::Diagnostics diagnostics;
+	options.diagnostics = &diagnostics;
+
+	FoxLang::CodeGen codegen(options, *target);
+	auto partitions = codegen.run(*tree);
+
+	FoxLang::MessagePrinter printer(sm, message_format(command));
+	handle_messages(diagnostics, printer);
+	if (command["--print-struct-layouts"] == true)
+		print_struct_layouts(*tree, partitions, sm);
+	if (options.optimize.time_passes) print_timings(codegen.timings);
+
+	auto &ir = *partitions.front().ir;
+	if (ir.broken) {
+		std::cerr << ir.errors;
+		return 1;
+	}
+
+	auto args = command.present<std::vector<std::string>>("args")
+					.value_or(std::vector<std::string>{});
+
+	int status;
+	if (auto err = FoxLang::JIT::run(ir, file_name, args, status)) {
+		std::cerr << "Could not run `" << file_name << "`: " << *err
+				  << std::endl;
+		return 1;
+	}
+
+	return status;
+}
+
+void handle_messages(FoxLang::Diagnostics &diagnostics,
+					 FoxLang::MessagePrinter &printer) {
+	for (auto &message : diagnostics.drain())
+		printer.print(message);
+	printer.flush();
 }
 
 void printTree(const std::string &prefix, const FoxLang::AST *node,
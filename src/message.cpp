@@ -1,55 +1,108 @@
 #include "message.hpp"
-#include <cctype>
-#include <cmath>
-#include <fstream>
+
+#include <iterator>
 
 namespace FoxLang {
-auto strip_whitespace(std::string str) {
-	auto start = str.begin();
-	int count = 0;
-	while (std::isspace(*start)) {
-		start++;
-		count++;
+void Message::render(fmt::memory_buffer &out, const SourceManager &sm) const {
+	auto it = std::back_inserter(out);
+	FullLoc full = sm.expand(span.loc);
+
+	if (level == Severity::Error)
+		fmt::format_to(it, fmt::emphasis::bold | fg(fmt::color::crimson),
+					   "error {}", code);
+	else
+		fmt::format_to(it, fmt::emphasis::bold | fg(fmt::color::light_yellow),
+					   "warning {}", code);
+	fmt::format_to(it, fmt::emphasis::bold, ": {}\n", message);
+	fmt::format_to(it, fg(fmt::color::light_green), " --> ");
+	fmt::format_to(it, "{}:{}:{}\n", full.fp, full.line, full.column);
+
+	if (full.line == 0) {
+		fmt::format_to(it, "\n");
+		return;
 	}
 
-	auto end = str.end();
-	while (std::isspace(*end))
-		end--;
-	struct {
-		std::string str;
-		int count;
-	} ret = {.str = std::string(start, end), .count = count};
-	return ret;
+	std::string number = fmt::format("{}", full.line);
+	std::string gutter(number.size(), ' ');
+	std::string_view line = sm.getLine(span.loc.file(), full.line);
+
+	fmt::format_to(it, fg(fmt::color::light_sky_blue), "{} |\n", gutter);
+	fmt::format_to(it, fg(fmt::color::light_sky_blue), "{} | ", number);
+	fmt::format_to(it, "{}\n", line);
+
+	// rebuild the start of the line so the carets land under the span no
+	// matter how it was indented, tabs and foxes included
+	std::string pad;
+	unsigned long column = 1;
+	for (size_t i = 0; i < line.size() && column < full.column; i++) {
+		if ((line[i] & 0b11000000) == 0b10000000) continue;
+		pad.push_back(line[i] == '\t' ? '\t' : ' ');
+		column++;
+	}
+
+	fmt::format_to(it, fg(fmt::color::light_sky_blue), "{} | ", gutter);
+	fmt::format_to(it, "{}", pad);
+	fmt::format_to(it, fg(fmt::color::crimson), "{:^>{}}\n\n", "",
+				   std::max<uint32_t>(span.length, 1));
 }
 
-void Message::print() {
-	if (level == Severity::Error)
-		fmt::print(fmt::emphasis::bold | fg(fmt::color::crimson), "error {}",
-				   code);
+static void escape_json(fmt::memory_buffer &out, std::string_view str) {
+	auto it = std::back_inserter(out);
+	out.push_back('"');
+	for (char c : str) {
+		switch (c) {
+		case '"':
+			fmt::format_to(it, "\\\"");
+			break;
+		case '\\':
+			fmt::format_to(it, "\\\\");
+			break;
+		case '\n':
+			fmt::format_to(it, "\\n");
+			break;
+		case '\t':
+			fmt::format_to(it, "\\t");
+			break;
+		default:
+			if ((unsigned char)c < 0x20)
+				fmt::format_to(it, "\\u{:04x}", (unsigned)c);
+			else
+				out.push_back(c);
+		}
+	}
+	out.push_back('"');
+}
+
+void Message::renderJson(fmt::memory_buffer &out,
+						 const SourceManager &sm) const {
+	auto it = std::back_inserter(out);
+	FullLoc full = sm.expand(span.loc);
+
+	fmt::format_to(it, "{{\"level\":\"{}\",\"code\":",
+				   level == Severity::Error ? "error" : "warning");
+	escape_json(out, code);
+	fmt::format_to(it, ",\"message\":");
+	escape_json(out, message);
+	fmt::format_to(it, ",\"file\":");
+	escape_json(out, full.fp);
+	fmt::format_to(it,
+				   ",\"line\":{},\"column\":{},\"offset\":{},\"length\":{}}}\n",
+				   full.line, full.column, span.loc.offset(), span.length);
+}
+
+void MessagePrinter::print(const Message &message) {
+	if (format == Format::Json)
+		message.renderJson(buffer, sm);
 	else
-		fmt::print(fmt::emphasis::bold | fg(fmt::color::light_yellow),
-				   "warning {}", code);
-	fmt::print(fmt::emphasis::bold, ": {}\n", message);
-	fmt::print(fg(fmt::color::light_green), " --> ");
-	fmt::print("{}:{}:{}\n", span.fp, span.line, span.column);
-
-	int digits = ceil(log10(span.line));
-
-	fmt::print(fg(fmt::color::light_sky_blue), "{} |\n",
-			   std::string(digits + 1, ' '));
-	fmt::print(fg(fmt::color::light_sky_blue), "{} |  ", span.line);
-
-	unsigned long len = span.end - span.start;
-	std::ifstream file(span.fp);
-	file.seekg(span.start);
-	// std::string line;
-	char line[len + 1];
-	file.read(line, len);
-
-	fmt::print("{}\n", std::string(line));
-	fmt::print(fg(fmt::color::light_sky_blue), "{} | {}",
-			   std::string(digits + 1, ' '),
-			   std::string(span.column - len, ' '));
-	fmt::print(fg(fmt::color::crimson), "{:^>{}}\n\n", "", len);
+		message.render(buffer, sm);
+
+	if (buffer.size() >= flush_threshold) flush();
+}
+
+void MessagePrinter::flush() {
+	if (buffer.size() == 0) return;
+	std::fwrite(buffer.data(), 1, buffer.size(), out);
+	std::fflush(out);
+	buffer.clear();
 }
 } // namespace FoxLang
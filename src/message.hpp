@@ -1,15 +1,17 @@
 #pragma once
 
+#include <cstdio>
 #include <fmt/color.h>
-#include <fmt/printf.h>
+#include <fmt/format.h>
 #include <string>
 
+#include "source_manager.hpp"
+
 namespace FoxLang {
 enum class Severity;
 struct Location {
-	std::string fp;
-	unsigned long line, column;
-	unsigned long start, end;
+	SourceLoc loc;
+	uint32_t length;
 };
 
 struct Message {
@@ -18,8 +20,36 @@ struct Message {
 	std::string code;
 	Location span;
 
-	void print();
+	/// Appends the colored, human readable form of the message to out
+	void render(fmt::memory_buffer &out, const SourceManager &sm) const;
+	/// Appends the message as a single line JSON object to out
+	void renderJson(fmt::memory_buffer &out, const SourceManager &sm) const;
 };
 
 enum class Severity { Error, Warning };
+
+/// MessagePrinter - Renders messages into one reusable buffer and writes it
+/// out in large chunks instead of a handful of tiny writes per message.
+class MessagePrinter {
+public:
+	enum class Format { Text, Json };
+
+	MessagePrinter(const SourceManager &sm, Format format,
+				   std::FILE *out = stdout)
+		: sm(sm), format(format), out(out) {}
+	~MessagePrinter() { flush(); }
+
+	void print(const Message &message);
+	void flush();
+
+private:
+	// big enough to batch a burst of warnings, small enough that messages
+	// still show up while a long compile is running
+	static constexpr size_t flush_threshold = 64 * 1024;
+
+	const SourceManager &sm;
+	Format format;
+	std::FILE *out;
+	fmt::memory_buffer buffer;
+};
 } // namespace FoxLang
@@ -18,23 +18,30 @@ void NameResolution::visit(BinaryExprAST &it) {
 }
 
 void NameResolution::visit(CallExprAST &it) {
-	if (function_scope.find(it.Callee) == function_scope.end())
-		messages.push_back(
-			Message{.message = fmt::format("Undefined function {}", it.Callee),
-					.level = Severity::Error,
-					.code = "E0200",
-					.span = Location{
-						.fp = "test.fox",
-						.line = 100,
-						.column = 3,
-						.start = 0,
-						.end = it.Callee.length(),
-					}});
-
-	it.resolved_name = function_scope[it.Callee];
+	using B = CallExprAST::Builtin;
+	// a function of the same name hides the builtin
+	if (function_scope.find(it.Callee) == function_scope.end()) {
+		it.builtin = CallExprAST::builtinNamed(it.Callee);
+		if (it.builtin == B::None)
+			diagnostics.report(Message{
+				.message = fmt::format("Undefined function {}", it.Callee),
+				.level = Severity::Error,
+				.code = "E0200",
+				.span = Location{
+					.loc = it.loc,
+					.length = (uint32_t)it.Callee.length(),
+				}});
+	}
+
+	if (it.builtin == B::None) it.resolved_name = function_scope[it.Callee];
 
 	for (auto i : it.Args)
 		i->accept(*this);
+
+	// storing into an array writes it just like an assignment
+	if ((it.builtin == B::Store || it.builtin == B::MaskedStore) &&
+		!it.Args.empty())
+		mutable_target(it, *it.Args.front(), true);
 }
 
 void NameResolution::visit(NumberExprAST &) {}
@@ -46,47 +53,86 @@ void NameResolution::visit(StructLiteralAST &it) {
 		i->accept(*this);
 }
 
-void NameResolution::visit(VariableExprAST &it) {
-	Scope *i = &scopes.back();
+void NameResolution::visit(ArrayLiteralAST &it) {
+	for (auto i : it.elements)
+		i->accept(*this);
+}
+
+void NameResolution::visit(IndexExprAST &it) {
+	it.array->accept(*this);
+	it.index->accept(*this);
+}
 
-	while (i >= &scopes.front()) {
+void NameResolution::visit(RefExprAST &it) {
+	it.target->accept(*this);
+	if (it.mut) mutable_target(it, *it.target);
+}
+
+void NameResolution::visit(DerefExprAST &it) { it.pointer->accept(*this); }
+
+// the member itself is looked up by TypeCheck, which knows the struct
+void NameResolution::visit(StructMemberAccessAST &it) {
+	it.parent->accept(*this);
+}
+
+void NameResolution::visit(LayoutExprAST &it) { it.type->accept(*this); }
+
+void NameResolution::visit(VariableExprAST &it) {
+	for (auto i = scopes.rbegin(); i != scopes.rend(); i++) {
 		if (i->find(it.name) != i->end()) {
 			it.resolved_name = (*i)[it.name];
 			return;
 		}
-
-		i--;
 	}
 
-	if (global_scope.find(it.name) != global_scope.end()) {
-		it.resolved_name = scopes.back()[it.name];
+	if (auto c = const_scope.find(it.name); c != const_scope.end()) {
+		it.resolved_name = c->second;
 		return;
 	}
 
-	messages.push_back(
+	diagnostics.report(
 		Message{.message = fmt::format("Undefined variable {}", it.name),
 				.level = Severity::Error,
 				.code = "E0201",
 				.span = Location{
-					.fp = "test.fox",
-					.line = 100,
-					.column = 3,
-					.start = 0,
-					.end = it.name.length(),
+					.loc = it.loc,
+					.length = (uint32_t)it.name.length(),
 				}});
 }
 
 void NameResolution::visit(FileAST &it) {
 	// do structs before functions because functions can return/use a struct
-	// that has not yet been defined
-	for (auto i : it.expressions)
+	// that has not yet been defined, same for consts used before their
+	// definition
+	for (auto i : it.expressions) {
 		if (auto sit = dynamic_cast<StructAST *>(i.get())) depth_struct(*sit);
+		if (auto vit = dynamic_cast<VarDecl *>(i.get()))
+			const_scope[vit->name] = vit;
+	}
 
 	for (auto i : it.expressions) {
 		auto fit = dynamic_cast<FunctionAST *>(i.get());
 		if (fit != nullptr) depth_proto(*fit->proto);
 	}
 
+	// a const ends up in the object next to the functions, and a name that
+	// means two things at the top level is a mistake either way
+	for (auto &[name, decl] : const_scope) {
+		std::string other;
+		if (global_scope.contains(name)) other = "struct";
+		if (function_scope.contains(name)) other = "function";
+		if (other.empty()) continue;
+		diagnostics.report(Message{
+			.message = fmt::format("Const {} has the same name as a {}", name,
+								   other),
+			.level = Severity::Error,
+			.code = "E0204",
+			.span = Location{
+				.loc = decl->loc,
+				.length = (uint32_t)name.length(),
+			}});
+	}
+
 	for (auto i : it.expressions)
 		i->accept(*this);
 }
@@ -99,6 +145,9 @@ void NameResolution::visit(ParameterAST &it) {
 void NameResolution::visit(FunctionAST &it) {
 	it.proto->accept(*this);
 	it.body->accept(*this);
+
+	// the parameter scope opened by the prototype
+	scopes.pop_back();
 }
 
 void NameResolution::visit(PrototypeAST &it) {
@@ -112,6 +161,42 @@ void NameResolution::visit(PrototypeAST &it) {
 }
 
 void NameResolution::visit(ExprStmt &it) { it.value->accept(*this); }
+
+void NameResolution::visit(AssignStmt &it) {
+	it.target->accept(*this);
+	it.value->accept(*this);
+
+	// writing an element changes the whole array, so it needs the same
+	// `let mut` as writing the variable
+	mutable_target(it, *it.target);
+}
+
+void NameResolution::mutable_target(AST &at, ExprAST &target, bool element) {
+	auto variable = IndexExprAST::root(target);
+	if (variable == nullptr || variable->resolved_name == nullptr) return;
+	auto decl = dynamic_cast<VarDecl *>(variable->resolved_name);
+	if (decl != nullptr && decl->mut) return;
+
+	// what a reference points to needs a `&mut` rather than a `let mut`,
+	// which TypeCheck can tell once it knows the types
+	auto param = dynamic_cast<ParameterAST *>(variable->resolved_name);
+	auto type = decl ? decl->type.get() : param ? param->type.get() : nullptr;
+	if (type != nullptr && type->type == TypeAST::Type::pointer &&
+		(element || variable != &target))
+		return;
+
+	bool borrow = dynamic_cast<RefExprAST *>(&at) != nullptr;
+	diagnostics.report(Message{
+		.message = fmt::format("Cannot {} {}, it is not `let mut`",
+							   borrow ? "take `&mut` of" : "assign to",
+							   variable->name),
+		.level = Severity::Error,
+		.code = "E0203",
+		.span = Location{
+			.loc = at.loc,
+			.length = (uint32_t)variable->name.length(),
+		}});
+}
 // void NameResolution::visit(Literal &) {}
 
 void NameResolution::visit(ReturnStmt &it) {
@@ -130,8 +215,23 @@ void NameResolution::visit(WhileStmt &it) {
 	it.block->accept(*this);
 }
 
+void NameResolution::visit(ForStmt &it) {
+	// the range is outside the loop, only the body sees the loop variable
+	if (it.array) it.array->accept(*this);
+	if (it.start) it.start->accept(*this);
+	if (it.end) it.end->accept(*this);
+	if (it.step) it.step.value()->accept(*this);
+	if (it.variable->type) it.variable->type->accept(*this);
+
+	scopes.push_back(Scope());
+	scopes.back()[it.variable->name] = it.variable.get();
+	it.block->accept(*this);
+	scopes.pop_back();
+}
+
 void NameResolution::visit(VarDecl &it) {
-	scopes.back()[it.name] = &it;
+	// globals were already added before anything else was resolved
+	if (!scopes.empty()) scopes.back()[it.name] = &it;
 
 	it.type->accept(*this);
 
@@ -167,6 +267,7 @@ case (p):                                                                      \
 			// PROCESS_VAL(T::string);
 			PROCESS_VAL(T::pointer);
 			PROCESS_VAL(T::array);
+			PROCESS_VAL(T::vector);
 		}
 #undef PROCESS_VAL
 	}();
@@ -174,26 +275,26 @@ case (p):                                                                      \
 // clang-format on
 
 void NameResolution::visit(TypeAST &it) {
-	std::cout << "Type: " << it.type << std::endl;
-	std::cout << "type data: " << it.data << std::endl;
-	if (it.type == TypeAST::Type::pointer)
-		return it.child.value()->accept(*this);
+	if (it.child) return it.child.value()->accept(*this);
 	if (it.type != TypeAST::Type::_struct) return;
 
-	if (global_scope.find(it.data) == global_scope.end())
-		messages.push_back(
-			Message{.message = fmt::format("Undefined type {}", it.data),
-					.level = Severity::Error,
-					.code = "E0202",
-					.span = Location{
-						.fp = "test.fox",
-						.line = 100,
-						.column = 3,
-						.start = 0,
-						.end = it.data.length(),
-					}});
-
-	it.resolved_name = static_cast<StructAST *>(global_scope[it.data]);
+	auto found = global_scope.find(it.data);
+	if (found == global_scope.end()) {
+		diagnostics.report(Message{
+			.message = const_scope.contains(it.data)
+						   ? fmt::format("{} is a const, not a type", it.data)
+						   : fmt::format("Undefined type {}", it.data),
+			.level = Severity::Error,
+			.code = "E0202",
+			.span = Location{
+				.loc = it.loc,
+				.length = (uint32_t)it.data.length(),
+			}});
+		it.resolved_name = nullptr;
+		return;
+	}
+
+	it.resolved_name = dynamic_cast<StructAST *>(found->second);
 }
 void NameResolution::visit(StructAST &it) {
 	global_scope[it.name] = &it;
@@ -2,7 +2,7 @@
 
 #include "ast_nodes.hpp"
 #include "ast_pass.hpp"
-#include "message.hpp"
+#include "diagnostics.hpp"
 #include <stack>
 
 namespace FoxLang {
@@ -12,10 +12,12 @@ class NameResolution : public ASTVisitor {
 	std::deque<Scope> scopes;
 	Scope global_scope;
 	Scope function_scope;
-	std::deque<Message> &messages;
+	// consts declared at the top level, which are values rather than types
+	Scope const_scope;
+	Diagnostics &diagnostics;
 
 public:
-	NameResolution(std::deque<Message> &m) : messages(m) {}
+	NameResolution(Diagnostics &d) : diagnostics(d) {}
 
 	virtual void visit(BlockAST &it);
 	virtual void visit(BinaryExprAST &it);
@@ -24,15 +26,23 @@ public:
 	virtual void visit(StringLiteralAST &it);
 	virtual void visit(BoolLiteralAST &it);
 	virtual void visit(StructLiteralAST &it);
+	virtual void visit(ArrayLiteralAST &it);
 	virtual void visit(VariableExprAST &it);
+	virtual void visit(IndexExprAST &it);
+	virtual void visit(RefExprAST &it);
+	virtual void visit(DerefExprAST &it);
+	virtual void visit(StructMemberAccessAST &it);
+	virtual void visit(LayoutExprAST &it);
 	virtual void visit(FileAST &it);
 	virtual void visit(ParameterAST &it);
 	virtual void visit(FunctionAST &it);
 	virtual void visit(PrototypeAST &it);
 	virtual void visit(ExprStmt &it);
+	virtual void visit(AssignStmt &it);
 	virtual void visit(ReturnStmt &it);
 	virtual void visit(IfStmt &it);
 	virtual void visit(WhileStmt &it);
+	virtual void visit(ForStmt &it);
 	virtual void visit(VarDecl &it);
 	virtual void visit(TypeAST &it);
 	virtual void visit(StructMemberAST &it);
@@ -40,5 +50,10 @@ public:
 
 	void depth_proto(PrototypeAST &);
 	void depth_struct(StructAST &);
+
+private:
+	/// Reports `target` unless it is, or is an element of, a `let mut`.
+	/// `element` is whether only the elements of `target` are written
+	void mutable_target(AST &at, ExprAST &target, bool element = false);
 };
 } // namespace FoxLang
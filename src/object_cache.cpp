@@ -0,0 +1,141 @@
+#include "object_cache.hpp"
+
+#include <llvm/ADT/StringExtras.h>
+#include <llvm/Bitcode/BitcodeWriter.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/Path.h>
+#include <llvm/Support/Process.h>
+#include <llvm/Support/SHA256.h>
+#include <llvm/Support/raw_ostream.h>
+
+#include <algorithm>
+#include <chrono>
+#include <tuple>
+#include <vector>
+
+namespace FoxLang {
+std::string ObjectCache::key(llvm::Module &module, const std::string &salt) {
+	auto name = module.getModuleIdentifier();
+	auto source = module.getSourceFileName();
+	module.setModuleIdentifier("");
+	module.setSourceFileName("");
+
+	llvm::SmallVector<char, 0> buffer;
+	llvm::raw_svector_ostream os(buffer);
+	llvm::WriteBitcodeToFile(module, os);
+
+	module.setModuleIdentifier(name);
+	module.setSourceFileName(source);
+
+	llvm::SHA256 hash;
+	hash.update(salt);
+	hash.update(llvm::StringRef(buffer.data(), buffer.size()));
+	return llvm::toHex(hash.final(), true);
+}
+
+std::string ObjectCache::path(const std::string &key) const {
+	// fan out on the first byte so no single directory gets huge
+	llvm::SmallString<128> p(dir);
+	llvm::sys::path::append(p, key.substr(0, 2), key + ".o");
+	return p.str().str();
+}
+
+bool ObjectCache::lookup(const std::string &key,
+						 llvm::SmallVectorImpl<char> &object) {
+	auto p = path(key);
+	auto buffer = llvm::MemoryBuffer::getFile(p);
+	if (!buffer) {
+		stats.misses++;
+		return false;
+	}
+
+	object.assign((*buffer)->getBufferStart(), (*buffer)->getBufferEnd());
+
+	// the modification time doubles as the last use, atime is often off
+	int fd;
+	if (!llvm::sys::fs::openFileForWrite(p, fd, llvm::sys::fs::CD_OpenExisting,
+										 llvm::sys::fs::OF_Append)) {
+		llvm::sys::fs::setLastAccessAndModificationTime(
+			fd, std::chrono::system_clock::now());
+		llvm::sys::Process::SafelyCloseFileDescriptor(fd);
+	}
+
+	stats.hits++;
+	return true;
+}
+
+void ObjectCache::store(const std::string &key, llvm::ArrayRef<char> object) {
+	auto p = path(key);
+	if (llvm::sys::fs::create_directories(llvm::sys::path::parent_path(p)))
+		return;
+
+	// written under a unique name and renamed, so readers never see a partial
+	// object even when several builds store the same key at once
+	int fd;
+	llvm::SmallString<128> tmp;
+	if (llvm::sys::fs::createUniqueFile(p + "-%%%%%%%%.tmp", fd, tmp)) return;
+
+	llvm::raw_fd_ostream os(fd, true);
+	os.write(object.data(), object.size());
+	os.close();
+
+	if (os.has_error() || llvm::sys::fs::rename(tmp, p)) {
+		os.clear_error();
+		llvm::sys::fs::remove(tmp);
+		return;
+	}
+
+	stats.stored++;
+}
+
+void ObjectCache::prune() {
+	struct Entry {
+		std::string path;
+		llvm::sys::TimePoint<> used;
+		uint64_t size;
+	};
+	std::vector<Entry> entries;
+	uint64_t total = 0;
+
+	auto now = std::chrono::system_clock::now();
+
+	std::error_code ec;
+	for (llvm::sys::fs::recursive_directory_iterator it(dir, ec), end;
+		 it != end && !ec; it.increment(ec)) {
+		llvm::sys::fs::file_status status;
+		if (llvm::sys::fs::status(it->path(), status)) continue;
+		if (status.type() != llvm::sys::fs::file_type::regular_file) continue;
+
+		// left behind by a build that died between writing and renaming
+		auto extension = llvm::sys::path::extension(it->path());
+		if (extension == ".tmp" &&
+			now - status.getLastModificationTime() > std::chrono::hours(1)) {
+			llvm::sys::fs::remove(it->path());
+			continue;
+		}
+		if (extension != ".o") continue;
+
+		entries.push_back(Entry{it->path(), status.getLastModificationTime(),
+								status.getSize()});
+		total += status.getSize();
+	}
+
+	if (total > max_size) {
+		// ties broken on the path so every build evicts the same entries
+		std::sort(entries.begin(), entries.end(), [](auto &a, auto &b) {
+			return std::tie(a.used, a.path) < std::tie(b.used, b.path);
+		});
+
+		for (auto &entry : entries) {
+			if (total <= max_size) break;
+			if (llvm::sys::fs::remove(entry.path)) continue;
+			total -= entry.size;
+			stats.evicted++;
+			stats.evicted_bytes += entry.size;
+		}
+	}
+
+	stats.size = total;
+}
+} // namespace FoxLang
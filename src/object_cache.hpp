@@ -0,0 +1,54 @@
+#pragma once
+
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/IR/Module.h>
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+namespace FoxLang {
+/// ObjectCache - A directory of object files keyed by a hash of the module
+/// they were compiled from and everything else that decides the machine code,
+/// so a partition that did not change between builds skips the optimizer and
+/// the backend. Entries are written to a temporary file and renamed into
+/// place, which keeps the directory safe to share between concurrent builds,
+/// including over NFS. Reading an entry touches it, and pruning removes the
+/// least recently used entries first.
+class ObjectCache {
+public:
+	struct Stats {
+		std::atomic<unsigned> hits = 0;
+		std::atomic<unsigned> misses = 0;
+		std::atomic<unsigned> stored = 0;
+		unsigned evicted = 0;
+		uint64_t evicted_bytes = 0;
+		uint64_t size = 0;
+	};
+
+	ObjectCache(std::string dir, uint64_t max_size)
+		: dir(std::move(dir)), max_size(max_size) {}
+
+	/// Hashes the bitcode of `module` together with `salt`, which should hold
+	/// the target and optimization options. The module's name and source file
+	/// are left out so moving a function to another partition keeps its key
+	static std::string key(llvm::Module &module, const std::string &salt);
+
+	/// Fills in `object` and returns true when `key` is in the cache
+	bool lookup(const std::string &key, llvm::SmallVectorImpl<char> &object);
+
+	void store(const std::string &key, llvm::ArrayRef<char> object);
+
+	/// Evicts the least recently used entries until the cache fits in
+	/// max_size again. Not safe to call while lookups or stores are running
+	void prune();
+
+	Stats stats;
+
+private:
+	std::string dir;
+	uint64_t max_size;
+
+	std::string path(const std::string &key) const;
+};
+} // namespace FoxLang
@@ -0,0 +1,136 @@
+#include "optimizer.hpp"
+
+#include <llvm/IR/PassInstrumentation.h>
+#include <llvm/Passes/PassBuilder.h>
+#include <llvm/Transforms/Utils/Mem2Reg.h>
+
+#include <algorithm>
+
+namespace FoxLang {
+std::optional<std::string> Optimizer::validate(const std::string &passes) {
+	llvm::PassBuilder pb;
+	llvm::ModulePassManager mpm;
+	if (auto err = pb.parsePassPipeline(mpm, passes))
+		return llvm::toString(std::move(err));
+	return std::nullopt;
+}
+
+void Optimizer::run(llvm::Module &module, llvm::TargetMachine *machine) {
+	typedef std::chrono::steady_clock Clock;
+
+	struct Running {
+		llvm::StringRef pass;
+		Clock::time_point start;
+		Clock::duration nested;
+	};
+	std::vector<Running> stack;
+
+	auto before = [&](llvm::StringRef pass) {
+		stack.push_back(Running{pass, Clock::now(), Clock::duration::zero()});
+	};
+	auto after = [&](llvm::StringRef pass) {
+		if (stack.empty() || stack.back().pass != pass) return;
+
+		auto elapsed = Clock::now() - stack.back().start;
+		auto self = elapsed - stack.back().nested;
+		stack.pop_back();
+		if (!stack.empty()) stack.back().nested += elapsed;
+
+		auto it = std::find_if(timings.begin(), timings.end(),
+							   [&](auto &t) { return t.pass == pass; });
+		if (it == timings.end())
+			it = timings.insert(timings.end(),
+								Timing{pass.str(), {}, 0});
+		it->time += self;
+		it->runs++;
+	};
+
+	// pass managers and adaptors only forward to the passes inside them
+	auto special = [](llvm::StringRef pass) {
+		return llvm::isSpecialPass(
+			pass, {"PassManager", "PassAdaptor", "AnalysisManagerProxy"});
+	};
+
+	llvm::PassInstrumentationCallbacks pic;
+	if (options.time_passes) {
+		pic.registerBeforeNonSkippedPassCallback(
+			[&](llvm::StringRef pass, llvm::Any) {
+				if (!special(pass)) before(pass);
+			});
+		pic.registerAfterPassCallback(
+			[&](llvm::StringRef pass, llvm::Any,
+				const llvm::PreservedAnalyses &) {
+				if (!special(pass)) after(pass);
+			});
+		pic.registerAfterPassInvalidatedCallback(
+			[&](llvm::StringRef pass, const llvm::PreservedAnalyses &) {
+				if (!special(pass)) after(pass);
+			});
+		pic.registerBeforeAnalysisCallback(
+			[&](llvm::StringRef pass, llvm::Any) {
+				if (!special(pass)) before(pass);
+			});
+		pic.registerAfterAnalysisCallback(
+			[&](llvm::StringRef pass, llvm::Any) {
+				if (!special(pass)) after(pass);
+			});
+	}
+
+	llvm::LoopAnalysisManager lam;
+	llvm::FunctionAnalysisManager fam;
+	llvm::CGSCCAnalysisManager cgam;
+	llvm::ModuleAnalysisManager mam;
+
+	llvm::PassBuilder pb(machine, llvm::PipelineTuningOptions(), std::nullopt,
+						 &pic);
+	pb.registerModuleAnalyses(mam);
+	pb.registerCGSCCAnalyses(cgam);
+	pb.registerFunctionAnalyses(fam);
+	pb.registerLoopAnalyses(lam);
+	pb.crossRegisterProxies(lam, fam, cgam, mam);
+
+	llvm::ModulePassManager mpm;
+	if (!options.passes.empty()) {
+		// the driver validated the pipeline before code generation started
+		llvm::cantFail(pb.parsePassPipeline(mpm, options.passes));
+	} else {
+		switch (options.level) {
+		case Level::O0:
+			mpm = pb.buildO0DefaultPipeline(llvm::OptimizationLevel::O0);
+			// mutable locals start out as allocas, promoting them is cheap
+			// and keeps even unoptimized loops in registers
+			mpm.addPass(
+				llvm::createModuleToFunctionPassAdaptor(llvm::PromotePass()));
+			break;
+		case Level::O1:
+			mpm = pb.buildPerModuleDefaultPipeline(llvm::OptimizationLevel::O1);
+			break;
+		case Level::O2:
+			mpm = pb.buildPerModuleDefaultPipeline(llvm::OptimizationLevel::O2);
+			break;
+		case Level::O3:
+			mpm = pb.buildPerModuleDefaultPipeline(llvm::OptimizationLevel::O3);
+			break;
+		case Level::Os:
+			mpm = pb.buildPerModuleDefaultPipeline(llvm::OptimizationLevel::Os);
+			break;
+		}
+	}
+
+	mpm.run(module, mam);
+}
+
+void Optimizer::merge(std::vector<Timing> &into,
+					  const std::vector<Timing> &from) {
+	for (auto &t : from) {
+		auto it = std::find_if(into.begin(), into.end(),
+							   [&](auto &i) { return i.pass == t.pass; });
+		if (it == into.end()) {
+			into.push_back(t);
+			continue;
+		}
+		it->time += t.time;
+		it->runs += t.runs;
+	}
+}
+} // namespace FoxLang
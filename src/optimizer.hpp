@@ -0,0 +1,52 @@
+#pragma once
+
+#include <llvm/IR/Module.h>
+#include <llvm/Target/TargetMachine.h>
+
+#include <chrono>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace FoxLang {
+/// Optimizer - Runs a new pass manager pipeline over a single module. Either
+/// one of the default pipelines for an optimization level, or a custom
+/// pipeline in the textual `opt -passes=` syntax.
+class Optimizer {
+public:
+	enum class Level { O0, O1, O2, O3, Os };
+
+	struct Options {
+		Level level = Level::O0;
+		// overrides the default pipeline of the level when not empty
+		std::string passes;
+		bool time_passes = false;
+	};
+
+	struct Timing {
+		std::string pass;
+		std::chrono::nanoseconds time;
+		unsigned runs;
+	};
+
+	Optimizer(Options options) : options(std::move(options)) {}
+
+	/// Returns why `passes` cannot be parsed, if it cannot
+	static std::optional<std::string> validate(const std::string &passes);
+
+	/// Runs the pipeline, tuned for `machine` when there is one
+	void run(llvm::Module &module, llvm::TargetMachine *machine);
+
+	/// Time spent in each pass and analysis, not counting the passes nested in
+	/// it, in the order they first ran. Only filled in with time_passes
+	std::vector<Timing> timings;
+
+	/// Adds the timings of `from` into `into`, appending passes `into` has not
+	/// seen yet in the order `from` ran them
+	static void merge(std::vector<Timing> &into,
+					  const std::vector<Timing> &from);
+
+private:
+	Options options;
+};
+} // namespace FoxLang
@@ -0,0 +1,70 @@
+#include "source_manager.hpp"
+
+#include <algorithm>
+
+namespace FoxLang {
+uint32_t SourceManager::addFile(std::string fp, std::string contents) {
+	// Both limits come from the bit split in SourceLoc, a file that does not
+	// fit cannot be pointed at, so refuse it and let the caller report it
+	if (files.size() >= SourceLoc::max_file) return 0;
+	if (contents.size() > SourceLoc::max_offset) return 0;
+
+	File &f = files.emplace_back();
+	f.fp = std::move(fp);
+	f.contents = std::move(contents);
+	return files.size();
+}
+
+const std::string &SourceManager::getBuffer(uint32_t file) const {
+	return files[file - 1].contents;
+}
+
+const std::string &SourceManager::getPath(uint32_t file) const {
+	return files[file - 1].fp;
+}
+
+FullLoc SourceManager::expand(SourceLoc loc) const {
+	if (!loc.valid() || loc.file() > files.size())
+		return FullLoc{.fp = "<unknown>", .line = 0, .column = 0};
+
+	const File &f = files[loc.file() - 1];
+	auto &lines = lineTable(f);
+
+	auto next = std::upper_bound(lines.begin(), lines.end(), loc.offset());
+	unsigned long line = next - lines.begin();
+	unsigned long column = 1;
+
+	uint32_t end = std::min<uint32_t>(loc.offset(), f.contents.size());
+	for (uint32_t i = *(next - 1); i < end; i++) {
+		// utf-8 continuation bytes do not start a new column
+		if ((f.contents[i] & 0b11000000) != 0b10000000) column++;
+	}
+
+	return FullLoc{.fp = f.fp, .line = line, .column = column};
+}
+
+std::string_view SourceManager::getLine(uint32_t file,
+										unsigned long line) const {
+	if (file == 0 || file > files.size()) return {};
+
+	const File &f = files[file - 1];
+	auto &lines = lineTable(f);
+	if (line == 0 || line > lines.size()) return {};
+
+	uint32_t start = lines[line - 1];
+	uint32_t end = line < lines.size() ? lines[line] - 1 : f.contents.size();
+	if (end > start && f.contents[end - 1] == '\r') end--;
+
+	return std::string_view(f.contents).substr(start, end - start);
+}
+
+const std::vector<uint32_t> &SourceManager::lineTable(const File &f) const {
+	std::call_once(f.lines_once, [&f] {
+		f.lines.push_back(0);
+		for (uint32_t i = 0; i < f.contents.size(); i++)
+			if (f.contents[i] == '\n') f.lines.push_back(i + 1);
+	});
+
+	return f.lines;
+}
+} // namespace FoxLang
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace FoxLang {
+/// SourceLoc - A packed reference to a single byte of a source file. The top
+/// bits hold the id the SourceManager handed out for the file and the rest
+/// hold the byte offset inside it, so every token and AST node can carry a
+/// location for the price of an int. A raw value of 0 means "no location".
+class SourceLoc {
+public:
+	static constexpr unsigned file_bits = 8;
+	static constexpr unsigned offset_bits = 32 - file_bits;
+	static constexpr uint32_t max_file = (1u << file_bits) - 1;
+	static constexpr uint32_t max_offset = (1u << offset_bits) - 1;
+
+	constexpr SourceLoc() = default;
+
+	static constexpr SourceLoc get(uint32_t file, uint32_t offset) {
+		SourceLoc l;
+		l.raw = (file << offset_bits) | (offset & max_offset);
+		return l;
+	}
+
+	constexpr uint32_t file() const { return raw >> offset_bits; }
+	constexpr uint32_t offset() const { return raw & max_offset; }
+	constexpr bool valid() const { return raw != 0; }
+	constexpr uint32_t getRaw() const { return raw; }
+
+	constexpr SourceLoc operator+(uint32_t n) const {
+		return get(file(), offset() + n);
+	}
+
+	constexpr bool operator==(const SourceLoc &rhs) const {
+		return raw == rhs.raw;
+	}
+	constexpr bool operator<(const SourceLoc &rhs) const {
+		return raw < rhs.raw;
+	}
+
+private:
+	uint32_t raw = 0;
+};
+
+static_assert(sizeof(SourceLoc) == 4);
+
+/// FullLoc - A SourceLoc expanded into something a human can read. Only
+/// built when a message is actually rendered.
+struct FullLoc {
+	std::string_view fp;
+	unsigned long line, column;
+};
+
+/// SourceManager - Owns the contents of every file taking part in the
+/// compilation and translates packed SourceLocs back into paths, lines and
+/// columns.
+class SourceManager {
+public:
+	/// Registers a file and returns the id to build SourceLocs with. Ids start
+	/// at 1 so a zeroed SourceLoc is never mistaken for a real one.
+	uint32_t addFile(std::string fp, std::string contents);
+
+	const std::string &getBuffer(uint32_t file) const;
+	const std::string &getPath(uint32_t file) const;
+
+	SourceLoc getStart(uint32_t file) const { return SourceLoc::get(file, 0); }
+
+	FullLoc expand(SourceLoc loc) const;
+
+	/// The text of a 1-based line, without its newline
+	std::string_view getLine(uint32_t file, unsigned long line) const;
+
+private:
+	struct File {
+		std::string fp;
+		std::string contents;
+
+		// offsets of the first byte of every line, built the first time the
+		// file is asked about so files without messages never pay for it
+		mutable std::once_flag lines_once;
+		mutable std::vector<uint32_t> lines;
+	};
+
+	const std::vector<uint32_t> &lineTable(const File &f) const;
+
+	// deque so that references handed out stay valid when files are added
+	std::deque<File> files;
+};
+} // namespace FoxLang
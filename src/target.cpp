@@ -0,0 +1,100 @@
+#include "target.hpp"
+
+#include <fmt/core.h>
+#include <llvm/MC/MCSubtargetInfo.h>
+#include <llvm/MC/TargetRegistry.h>
+#include <llvm/Support/TargetSelect.h>
+#include <llvm/TargetParser/Host.h>
+#include <llvm/TargetParser/SubtargetFeature.h>
+#include <llvm/TargetParser/Triple.h>
+
+#include <algorithm>
+#include <mutex>
+#include <vector>
+
+namespace FoxLang {
+std::unique_ptr<Target> Target::create(const std::string &triple,
+									   const std::string &cpu,
+									   const std::string &features,
+									   std::string &error) {
+	static std::once_flag initialized;
+	std::call_once(initialized, [] {
+		llvm::InitializeAllTargetInfos();
+		llvm::InitializeAllTargets();
+		llvm::InitializeAllTargetMCs();
+		llvm::InitializeAllAsmPrinters();
+		llvm::InitializeAllAsmParsers();
+	});
+
+	auto normalized = triple.empty() ? llvm::sys::getDefaultTargetTriple()
+									 : llvm::Triple::normalize(triple);
+	auto target = llvm::TargetRegistry::lookupTarget(normalized, error);
+	if (target == nullptr) return nullptr;
+
+	if (cpu != "native") {
+		// llvm would only warn and fall back to the baseline
+		std::unique_ptr<llvm::MCSubtargetInfo> info(
+			target->createMCSubtargetInfo(normalized, "", ""));
+		if (!info->isCPUStringValid(cpu)) {
+			error = fmt::format("unknown cpu `{}` for {}", cpu, normalized);
+			return nullptr;
+		}
+		return std::unique_ptr<Target>(
+			new Target(target, normalized, cpu, features));
+	}
+
+	// the host cpu means nothing to a different architecture
+	llvm::Triple host(llvm::sys::getProcessTriple());
+	if (llvm::Triple(normalized).getArch() != host.getArch()) {
+		error = fmt::format("cannot use the native cpu when targeting {}",
+							normalized);
+		return nullptr;
+	}
+
+	// the name alone is not enough, a cpu can have features turned off by
+	// the os or a hypervisor
+	auto host_features = llvm::sys::getHostCPUFeatures();
+	// sorted, the map's order would otherwise leak into the cache keys
+	std::vector<std::pair<std::string, bool>> sorted;
+	for (auto &f : host_features)
+		sorted.emplace_back(f.getKey().str(), f.getValue());
+	std::sort(sorted.begin(), sorted.end());
+
+	llvm::SubtargetFeatures native;
+	for (auto &[name, enabled] : sorted)
+		native.AddFeature(name, enabled);
+	// given after the host's so they win
+	for (auto &f : llvm::SubtargetFeatures(features).getFeatures())
+		native.AddFeature(f);
+
+	return std::unique_ptr<Target>(
+		new Target(target, normalized, llvm::sys::getHostCPUName().str(),
+				   native.getString()));
+}
+
+std::unique_ptr<llvm::TargetMachine>
+Target::createMachine(Optimizer::Level level) const {
+	llvm::CodeGenOptLevel opt = llvm::CodeGenOptLevel::Default;
+	switch (level) {
+	case Optimizer::Level::O0:
+		opt = llvm::CodeGenOptLevel::None;
+		break;
+	case Optimizer::Level::O1:
+		opt = llvm::CodeGenOptLevel::Less;
+		break;
+	case Optimizer::Level::O2:
+	case Optimizer::Level::Os:
+		opt = llvm::CodeGenOptLevel::Default;
+		break;
+	case Optimizer::Level::O3:
+		opt = llvm::CodeGenOptLevel::Aggressive;
+		break;
+	}
+
+	// position independent so the objects can go into PIE executables, which
+	// is what every current linker produces by default
+	return std::unique_ptr<llvm::TargetMachine>(target->createTargetMachine(
+		triple, cpu, features, llvm::TargetOptions(), llvm::Reloc::PIC_,
+		std::nullopt, opt));
+}
+} // namespace FoxLang
@@ -0,0 +1,41 @@
+#pragma once
+
+#include "optimizer.hpp"
+
+#include <llvm/Target/TargetMachine.h>
+
+#include <memory>
+#include <string>
+
+namespace FoxLang {
+/// Target - The machine code is generated for. Holds what is needed to
+/// build a TargetMachine, since a machine must not be shared between the
+/// threads generating code.
+class Target {
+public:
+	/// Looks `triple` up in the targets LLVM was built with, an empty triple
+	/// is the host's. A `cpu` of "native" is replaced by the host CPU and its
+	/// features, which `features` can still add to or take away from.
+	/// Returns nullptr and fills in `error` when there is no such target.
+	static std::unique_ptr<Target> create(const std::string &triple,
+										  const std::string &cpu,
+										  const std::string &features,
+										  std::string &error);
+
+	std::unique_ptr<llvm::TargetMachine>
+	createMachine(Optimizer::Level level) const;
+
+	const std::string &getTriple() const { return triple; }
+	const std::string &getCPU() const { return cpu; }
+	const std::string &getFeatures() const { return features; }
+
+private:
+	Target(const llvm::Target *target, std::string triple, std::string cpu,
+		   std::string features)
+		: target(target), triple(std::move(triple)), cpu(std::move(cpu)),
+		  features(std::move(features)) {}
+
+	const llvm::Target *target;
+	std::string triple, cpu, features;
+};
+} // namespace FoxLang
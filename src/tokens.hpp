@@ -3,23 +3,20 @@
 #include <optional>
 #include <string>
 
+#include "source_manager.hpp"
+
 namespace FoxLang {
 enum class TokenType;
 
 class Token {
 public:
-	Token(TokenType type, std::string lexeme, unsigned long line,
-		  unsigned long column, unsigned long char_start, std::string fp)
-		: type(type), lexeme(lexeme), line(line), column(column),
-		  char_start(char_start), fp(fp) {}
+	Token(TokenType type, std::string lexeme, SourceLoc loc)
+		: type(type), lexeme(lexeme), loc(loc) {}
 
 public:
 	TokenType type;
 	std::string lexeme;
-	unsigned long line;
-	unsigned long column;
-	unsigned long char_start;
-	std::string fp;
+	SourceLoc loc;
 	template <typename T> using Option = std::optional<T>;
 };
 
@@ -39,8 +36,11 @@ enum class TokenType {
 	COLON,
 	SLASH,
 	STAR,
+	PERCENT,
+	HASH,
 
 	// One or two character tokens.
+	DOT_DOT,
 	BANG,
 	BANG_EQUAL,
 	EQUAL,
@@ -70,6 +70,7 @@ enum class TokenType {
 	FUNC,
 	EXTERN,
 	FOR,
+	IN,
 	IF,
 	RETURN,
 	SELF,
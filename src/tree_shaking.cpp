@@ -0,0 +1,153 @@
+#include "tree_shaking.hpp"
+
+namespace FoxLang {
+void TreeShaker::reach(AST *node) {
+	if (node != nullptr && reached.insert(node).second)
+		worklist.push_back(node);
+}
+
+void TreeShaker::visit(FileAST &it) {
+	bool rooted = false;
+
+	for (auto i : it.expressions) {
+		auto fit = dynamic_cast<FunctionAST *>(i.get());
+		if (fit == nullptr) continue;
+
+		functions[fit->proto.get()] = fit;
+		if (fit->proto->name == "main" || exports.contains(fit->proto->name)) {
+			reach(fit);
+			rooted = true;
+		}
+	}
+
+	// no entry point and nothing exported, there is nothing to measure
+	// reachability from so keep everything
+	if (!rooted) return;
+
+	// every const is lowered whether anything reads it or not, so the
+	// structs its type names are too
+	for (auto i : it.expressions)
+		if (auto decl = dynamic_cast<VarDecl *>(i.get()))
+			decl->type->accept(*this);
+
+	while (!worklist.empty()) {
+		AST *node = worklist.back();
+		worklist.pop_back();
+		node->accept(*this);
+	}
+
+	for (auto i : it.expressions) {
+		if (reached.contains(i.get())) continue;
+
+		if (auto fit = dynamic_cast<FunctionAST *>(i.get())) {
+			fit->used = false;
+			skipped.push_back(fit);
+		} else if (auto sit = dynamic_cast<StructAST *>(i.get())) {
+			sit->used = false;
+			skipped.push_back(sit);
+		}
+	}
+}
+
+void TreeShaker::visit(FunctionAST &it) {
+	it.proto->accept(*this);
+	it.body->accept(*this);
+}
+
+void TreeShaker::visit(PrototypeAST &it) {
+	for (auto i : it.parameters)
+		i->accept(*this);
+	it.retType->accept(*this);
+}
+
+void TreeShaker::visit(ParameterAST &it) { it.type->accept(*this); }
+
+void TreeShaker::visit(CallExprAST &it) {
+	if (auto proto = dynamic_cast<PrototypeAST *>(it.resolved_name))
+		reach(functions[proto]);
+
+	for (auto i : it.Args)
+		i->accept(*this);
+}
+
+void TreeShaker::visit(TypeAST &it) {
+	if (it.type == TypeAST::Type::_struct) reach(it.resolved_name);
+	if (it.child) it.child.value()->accept(*this);
+}
+
+void TreeShaker::visit(StructAST &it) {
+	for (auto i : it.members)
+		i->accept(*this);
+}
+
+void TreeShaker::visit(StructMemberAST &it) { it.value->accept(*this); }
+
+void TreeShaker::visit(BlockAST &it) {
+	for (auto i : it.content)
+		i->accept(*this);
+}
+
+void TreeShaker::visit(BinaryExprAST &it) {
+	it.LHS->accept(*this);
+	it.RHS->accept(*this);
+}
+
+void TreeShaker::visit(StructLiteralAST &it) {
+	for (auto i : it.values)
+		i->accept(*this);
+}
+
+void TreeShaker::visit(ArrayLiteralAST &it) {
+	for (auto i : it.elements)
+		i->accept(*this);
+}
+
+void TreeShaker::visit(IndexExprAST &it) {
+	it.array->accept(*this);
+	it.index->accept(*this);
+}
+
+void TreeShaker::visit(RefExprAST &it) { it.target->accept(*this); }
+void TreeShaker::visit(DerefExprAST &it) { it.pointer->accept(*this); }
+void TreeShaker::visit(StructMemberAccessAST &it) { it.parent->accept(*this); }
+void TreeShaker::visit(LayoutExprAST &it) { it.type->accept(*this); }
+
+void TreeShaker::visit(ExprStmt &it) { it.value->accept(*this); }
+
+void TreeShaker::visit(AssignStmt &it) {
+	// an index in the target can call functions too
+	it.target->accept(*this);
+	it.value->accept(*this);
+}
+
+void TreeShaker::visit(ReturnStmt &it) {
+	if (it.value) it.value.value()->accept(*this);
+}
+
+void TreeShaker::visit(IfStmt &it) {
+	it.condition->accept(*this);
+	it.block->accept(*this);
+	if (it.else_) it.else_.value()->accept(*this);
+}
+
+void TreeShaker::visit(WhileStmt &it) {
+	it.condition->accept(*this);
+	it.block->accept(*this);
+}
+
+void TreeShaker::visit(ForStmt &it) {
+	if (it.variable->type) it.variable->type->accept(*this);
+	for (auto child : it.getChildren())
+		child->accept(*this);
+}
+
+void TreeShaker::visit(VarDecl &it) {
+	it.type->accept(*this);
+	if (it.value) it.value.value()->accept(*this);
+}
+
+void TreeShaker::visit(NumberExprAST &) {}
+void TreeShaker::visit(StringLiteralAST &) {}
+void TreeShaker::visit(BoolLiteralAST &) {}
+void TreeShaker::visit(VariableExprAST &) {}
+} // namespace FoxLang
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "ast_nodes.hpp"
+#include "ast_pass.hpp"
+
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace FoxLang {
+/// TreeShaker - Walks the call and type graph left behind by name resolution
+/// starting at `main` and any exported symbols, and flags every function and
+/// struct nothing can reach so the IR generator never lowers them.
+class TreeShaker : public ASTVisitor {
+public:
+	TreeShaker(std::set<std::string> exports) : exports(std::move(exports)) {}
+
+	/// Everything flagged unused, in source order, for reporting
+	std::vector<AST *> skipped;
+
+	virtual void visit(BlockAST &it);
+	virtual void visit(BinaryExprAST &it);
+	virtual void visit(CallExprAST &it);
+	virtual void visit(NumberExprAST &it);
+	virtual void visit(StringLiteralAST &it);
+	virtual void visit(BoolLiteralAST &it);
+	virtual void visit(StructLiteralAST &it);
+	virtual void visit(ArrayLiteralAST &it);
+	virtual void visit(VariableExprAST &it);
+	virtual void visit(IndexExprAST &it);
+	virtual void visit(RefExprAST &it);
+	virtual void visit(DerefExprAST &it);
+	virtual void visit(StructMemberAccessAST &it);
+	virtual void visit(LayoutExprAST &it);
+	virtual void visit(FileAST &it);
+	virtual void visit(ParameterAST &it);
+	virtual void visit(FunctionAST &it);
+	virtual void visit(PrototypeAST &it);
+	virtual void visit(ExprStmt &it);
+	virtual void visit(AssignStmt &it);
+	virtual void visit(ReturnStmt &it);
+	virtual void visit(IfStmt &it);
+	virtual void visit(WhileStmt &it);
+	virtual void visit(ForStmt &it);
+	virtual void visit(VarDecl &it);
+	virtual void visit(TypeAST &it);
+	virtual void visit(StructMemberAST &it);
+	virtual void visit(StructAST &it);
+
+private:
+	std::set<std::string> exports;
+	std::map<PrototypeAST *, FunctionAST *> functions;
+	std::set<AST *> reached;
+	std::vector<AST *> worklist;
+
+	void reach(AST *node);
+};
+} // namespace FoxLang
@@ -1,62 +1,900 @@
 #include "type_check.hpp"
+#include "ir_generator.hpp"
+#include "message.hpp"
+
+#include <algorithm>
+#include <llvm/ADT/StringRef.h>
 
 namespace FoxLang {
+void TypeCheck::error(AST &node, std::string message, std::string code) {
+	error(node.loc, std::move(message), std::move(code));
+}
+
+void TypeCheck::error(SourceLoc loc, std::string message, std::string code) {
+	diagnostics.report(Message{.message = std::move(message),
+							   .level = Severity::Error,
+							   .code = std::move(code),
+							   .span = Location{.loc = loc, .length = 1}});
+}
+
+void TypeCheck::infer(ExprAST &expr, TypeAST *want) {
+	auto saved = expected;
+	expected = want;
+	expr.accept(*this);
+	expected = saved;
+}
+
+void TypeCheck::check(ExprAST &expr, TypeAST *want) {
+	infer(expr, want);
+
+	if (want == nullptr || expr.checked_type == nullptr) return;
+
+	// a `&mut` does for a `&` to the same type
+	auto got = expr.checked_type;
+	if (got->type == TypeAST::Type::pointer && want->type == got->type &&
+		got->mut && !want->mut && *got->child.value() == *want->child.value())
+		return;
+
+	if (*expr.checked_type != *want)
+		error(expr,
+			  fmt::format("expected {}, found {}", want->spelling(),
+						  expr.checked_type->spelling()),
+			  "E0300");
+}
+
 void TypeCheck::visit(BlockAST &it) {
 	for (auto c : it.content)
 		c->accept(*this);
 }
 
+// sizeof and friends are constants that take the type wanted just the same
+static bool is_literal(ExprAST &expr) {
+	return dynamic_cast<NumberExprAST *>(&expr) != nullptr ||
+		   dynamic_cast<LayoutExprAST *>(&expr) != nullptr;
+}
+
 void TypeCheck::visit(BinaryExprAST &it) {
-	lit_type = null;
-	it.LHS->accept(*this);
-	auto left = expr_type;
-	auto left_lit = lit_type;
+	using T = TypeAST::Type;
+	auto op = it.Op.type;
+
+	bool logical = op == TokenType::AND || op == TokenType::OR;
+	bool comparison =
+		op == TokenType::LESS || op == TokenType::LESS_EQUAL ||
+		op == TokenType::GREATER || op == TokenType::GREATER_EQUAL ||
+		op == TokenType::EQUAL_EQUAL || op == TokenType::BANG_EQUAL;
+
+	// arithmetic passes the wanted type down to its operands, a comparison
+	// gives a bool whatever its operands are
+	TypeAST *want = expected;
+	if (logical)
+		want = TypeAST::builtin(T::_bool);
+	else if (comparison)
+		want = nullptr;
+
+	if (want == nullptr && is_literal(*it.LHS)) {
+		// a literal on the left learns its type from the right
+		infer(*it.RHS, nullptr);
+		infer(*it.LHS, it.RHS->checked_type);
+	} else {
+		infer(*it.LHS, want);
+		infer(*it.RHS, want != nullptr ? want : it.LHS->checked_type);
+	}
+
+	auto l = it.LHS->checked_type, r = it.RHS->checked_type;
+	if (l == nullptr || r == nullptr) return;
+
+	if (*l != *r) {
+		error(it,
+			  fmt::format("mismatched types {} and {} for `{}`", l->spelling(),
+						  r->spelling(), it.Op.lexeme),
+			  "E0300");
+		return;
+	}
+
+	// vectors work lane by lane, with the operators of their lanes
+	auto &e = l->scalar();
+	bool integer = e.isInteger(), number = integer || e.isFloat();
+	bool ok = false;
+	switch (op) {
+	case TokenType::AND:
+	case TokenType::OR:
+		ok = l->type == T::_bool;
+		break;
+	case TokenType::EQUAL_EQUAL:
+	case TokenType::BANG_EQUAL:
+		ok = number || e.type == T::_bool;
+		break;
+	case TokenType::LEFT_SHIFT:
+	case TokenType::RIGHT_SHIFT:
+		ok = integer;
+		break;
+	default:
+		ok = number;
+		break;
+	}
+
+	if (!ok) {
+		error(it,
+			  fmt::format("`{}` cannot be applied to {}", it.Op.lexeme,
+						  l->spelling()),
+			  "E0301");
+		return;
+	}
+
+	if (comparison && l->isVector()) {
+		// one bool per lane, a mask for the masked builtins
+		it.inferred = std::make_shared<TypeAST>(
+			T::vector, std::make_shared<TypeAST>(T::_bool, std::nullopt, ""),
+			"");
+		it.inferred->length = l->length;
+		it.inferred->loc = it.loc;
+		it.checked_type = it.inferred.get();
+		return;
+	}
+
+	it.checked_type = logical || comparison ? TypeAST::builtin(T::_bool) : l;
+}
+
+void TypeCheck::visit(CallExprAST &it) {
+	if (it.builtin != CallExprAST::Builtin::None) return builtin(it);
+
+	auto proto = dynamic_cast<PrototypeAST *>(it.resolved_name);
+	if (proto == nullptr) return;
+
+	if (proto->parameters.size() != it.Args.size()) {
+		error(it,
+			  fmt::format("{} takes {} arguments but {} were given",
+						  proto->name, proto->parameters.size(),
+						  it.Args.size()),
+			  "E0302");
+		return;
+	}
+
+	for (size_t i = 0; i < it.Args.size(); i++)
+		check(*it.Args[i], proto->parameters[i]->type.get());
+	exclusive(it, *proto);
+
+	it.checked_type = proto->retType.get();
+}
+
+// whether a value of `type` holds a reference anywhere, itself or in one
+// of its elements or members
+static bool holds_reference(const TypeAST &type) {
+	using T = TypeAST::Type;
+	if (type.type == T::pointer) return true;
+	if (type.type == T::array || type.isVector())
+		return holds_reference(*type.child.value());
+	if (type.type == T::_struct && type.resolved_name != nullptr)
+		for (auto &member : type.resolved_name->members)
+			if (holds_reference(*member->value)) return true;
+	return false;
+}
+
+void TypeCheck::exclusive(CallExprAST &call, PrototypeAST &proto) {
+	// the generator marks `&mut` parameters noalias, which only holds when
+	// nothing else passed in reaches the same variable. Different parameters
+	// of the caller never overlap for the same reason
+	for (size_t i = 0; i < call.Args.size(); i++) {
+		auto &type = *proto.parameters[i]->type;
+		if (type.type != TypeAST::Type::pointer) continue;
+
+		for (size_t j = 0; j < call.Args.size(); j++) {
+			auto &other = *proto.parameters[j]->type;
+			if (j == i || !holds_reference(other)) continue;
+
+			// a reference in a struct or array is never noalias itself, and
+			// where it points cannot be told, so it may overlap a `&mut`
+			bool direct = other.type == TypeAST::Type::pointer;
+			if (!type.mut && (!direct || !other.mut)) continue;
+
+			auto a = RefExprAST::borrowed(*call.Args[i]);
+			auto b = direct ? RefExprAST::borrowed(*call.Args[j]) : nullptr;
+			if (a != nullptr && b != nullptr && a != b) continue;
+			auto &arg = *call.Args[type.mut ? i : j];
+			error(arg,
+				  fmt::format("{} takes a `&mut` here, which may overlap "
+							  "another reference passed to it",
+							  proto.name),
+				  "E0321");
+			return;
+		}
+	}
+}
+
+TypeAST *TypeCheck::vector(CallExprAST &call, ExprAST &arg) {
+	auto type = arg.checked_type;
+	if (type == nullptr || type->isVector()) return type;
+
+	error(arg,
+		  fmt::format("`{}` needs a vector, found {}", call.Callee,
+					  type->spelling()),
+		  "E0312");
+	return nullptr;
+}
+
+void TypeCheck::builtin(CallExprAST &it) {
+	using B = CallExprAST::Builtin;
+	using T = TypeAST::Type;
+	auto want = expected;
+
+	size_t arity = 1;
+	switch (it.builtin) {
+	case B::Shuffle:
+		arity = std::max<size_t>(3, it.Args.size());
+		break;
+	case B::Load:
+		arity = 2;
+		break;
+	case B::Store:
+		arity = 3;
+		break;
+	case B::MaskedLoad:
+	case B::MaskedStore:
+		arity = 4;
+		break;
+	default:
+		break;
+	}
+	if (it.Args.size() != arity) {
+		error(it,
+			  fmt::format("{} takes {} arguments but {} were given",
+						  it.Callee, arity, it.Args.size()),
+			  "E0302");
+		return;
+	}
+
+	switch (it.builtin) {
+	case B::None:
+		return;
 
-	lit_type = null;
-	it.RHS->accept(*this);
-	auto right = expr_type;
-	auto right_lit = lit_type;
-	lit_type = null;
+	case B::Likely:
+	case B::Unlikely:
+		check(*it.Args[0], TypeAST::builtin(T::_bool));
+		it.checked_type = TypeAST::builtin(T::_bool);
+		return;
+
+	case B::Splat:
+		if (want == nullptr || !want->isVector()) {
+			infer(*it.Args[0], nullptr);
+			error(it, "cannot tell which vector `splat` makes", "E0312");
+			return;
+		}
+		check(*it.Args[0], want->child.value().get());
+		it.checked_type = want;
+		return;
 
-	if (left_lit != null && right_lit != null) {
-		compare_lit_types(left_lit, right_lit);
+	case B::Shuffle: {
+		infer(*it.Args[0], nullptr);
+		auto v = vector(it, *it.Args[0]);
+		check(*it.Args[1], v);
+		if (v == nullptr) return;
+
+		// lanes of the first vector come first, then those of the second
+		for (size_t i = 2; i < it.Args.size(); i++) {
+			auto &arg = *it.Args[i];
+			infer(arg, TypeAST::builtin(T::u32));
+			auto number = dynamic_cast<NumberExprAST *>(&arg);
+			uint64_t lane;
+			if (number == nullptr ||
+				llvm::StringRef(number->value).getAsInteger(10, lane))
+				error(arg, "the lanes of a shuffle have to be literal numbers",
+					  "E0313");
+			else if (lane >= 2 * v->length)
+				error(arg,
+					  fmt::format("lane {} is out of bounds for two {}", lane,
+								  v->spelling()),
+					  "E0311");
+		}
+
+		it.inferred = std::make_shared<TypeAST>(
+			T::vector, std::make_shared<TypeAST>(*v->child.value()), "");
+		it.inferred->length = it.Args.size() - 2;
+		it.inferred->loc = it.loc;
+		it.checked_type = it.inferred.get();
 		return;
 	}
 
-	if (left_lit != null || right_lit != null) {
-		compare_lit_types(*left, left_lit, *right, right_lit);
+	case B::ReduceAdd:
+	case B::ReduceMul:
+	case B::ReduceMin:
+	case B::ReduceMax:
+	case B::ReduceAnd:
+	case B::ReduceOr: {
+		infer(*it.Args[0], nullptr);
+		auto v = vector(it, *it.Args[0]);
+		if (v == nullptr) return;
+
+		auto e = v->child.value().get();
+		bool bitwise = it.builtin == B::ReduceAnd || it.builtin == B::ReduceOr;
+		bool ok = bitwise ? e->isInteger() || e->type == T::_bool
+						  : e->isInteger() || e->isFloat();
+		if (!ok) {
+			error(it,
+				  fmt::format("`{}` cannot be applied to {}", it.Callee,
+							  v->spelling()),
+				  "E0301");
+			return;
+		}
+		it.checked_type = e;
 		return;
 	}
 
-	if (*left != *right) std::cout << "Error: types not equal" << std::endl;
-	expr_type = left;
+	case B::Load:
+	case B::Store:
+	case B::MaskedLoad:
+	case B::MaskedStore: {
+		infer(*it.Args[0], nullptr);
+		infer(*it.Args[1], nullptr);
+		deref(it.Args[0]);
+		if (it.builtin == B::Store || it.builtin == B::MaskedStore)
+			writable(it, *it.Args[0]);
+		auto array = it.Args[0]->checked_type, index = it.Args[1]->checked_type;
+		if (array != nullptr && array->type != T::array) {
+			error(*it.Args[0],
+				  fmt::format("`{}` needs an array, found {}", it.Callee,
+							  array->spelling()),
+				  "E0312");
+			array = nullptr;
+		}
+		if (index != nullptr && !index->isInteger())
+			error(*it.Args[1],
+				  fmt::format("an index must be an integer, found {}",
+							  index->spelling()),
+				  "E0310");
+
+		// the vector is the result of a load, the value of a store
+		TypeAST *v = want, *mask = nullptr;
+		if (it.builtin == B::Load) {
+			if (want == nullptr || !want->isVector()) {
+				error(it, "cannot tell which vector `load` makes", "E0312");
+				return;
+			}
+		} else {
+			auto &value = *it.Args[it.builtin == B::MaskedLoad ? 3 : 2];
+			infer(value, it.builtin == B::MaskedLoad ? want : nullptr);
+			v = vector(it, value);
+		}
+		if (it.builtin == B::MaskedLoad || it.builtin == B::MaskedStore) {
+			auto &arg = *it.Args[it.builtin == B::MaskedLoad ? 2 : 3];
+			infer(arg, nullptr);
+			mask = vector(it, arg);
+			if (mask != nullptr && v != nullptr &&
+				(mask->length != v->length ||
+				 mask->child.value()->type != T::_bool)) {
+				error(arg,
+					  fmt::format("expected vec[{}]bool, found {}", v->length,
+								  mask->spelling()),
+					  "E0300");
+			}
+		}
+		if (array == nullptr || v == nullptr) return;
+
+		if (*array->child.value() != *v->child.value()) {
+			error(it,
+				  fmt::format("`{}` cannot move {} in and out of {}",
+							  it.Callee, v->spelling(), array->spelling()),
+				  "E0312");
+			return;
+		}
+		if (v->length > array->length) {
+			error(it,
+				  fmt::format("{} does not fit in {}", v->spelling(),
+							  array->spelling()),
+				  "E0311");
+			return;
+		}
+
+		if (it.builtin == B::Load || it.builtin == B::MaskedLoad)
+			it.checked_type = v;
+		return;
+	}
+	}
 }
 
-void TypeCheck::visit(CallExprAST &it) {}
+void TypeCheck::visit(NumberExprAST &it) {
+	using T = TypeAST::Type;
+	bool is_float = it.value.find('.') != std::string::npos;
+
+	auto type = expected;
+	if (type == nullptr || !(type->isInteger() || type->isFloat()))
+		type = TypeAST::builtin(is_float ? T::f64 : T::i32);
+
+	if (is_float && type->isInteger()) {
+		it.checked_type = TypeAST::builtin(T::f64);
+		return;
+	}
+
+	if (type->isInteger()) {
+		llvm::APInt value;
+		// getAsInteger refuses values that need more bits than they are given
+		if (llvm::StringRef(it.value).getAsInteger(10, value) ||
+			(type->isSigned() ? value.getActiveBits() >= type->bits()
+							  : value.getActiveBits() > type->bits())) {
+			error(it,
+				  fmt::format("{} does not fit in {}", it.value,
+							  type->spelling()),
+				  "E0303");
+		}
+	}
+
+	it.checked_type = type;
+}
+
+void TypeCheck::visit(StringLiteralAST &) {}
+void TypeCheck::visit(BoolLiteralAST &it) {
+	it.checked_type = TypeAST::builtin(TypeAST::Type::_bool);
+}
+// the member of `type` called `name`, members.size() when there is none
+static size_t member(const TypeAST &type, const std::string &name) {
+	auto &members = type.resolved_name->members;
+	for (size_t i = 0; i < members.size(); i++)
+		if (members[i]->name == name) return i;
+	return members.size();
+}
 
-void TypeCheck::visit(NumberExprAST &it) { lit_type = TypeAST::Type::__uint; }
-void TypeCheck::visit(StringLiteralAST &it) {}
-void TypeCheck::visit(BoolLiteralAST &it) { lit_type = TypeAST::Type::_bool; }
 void TypeCheck::visit(StructLiteralAST &it) {
-	// TODO: gotta fix the ptr, then go inside and check types
-	lit_type = TypeAST::Type::_struct;
+	// `.{ .x = 1 }` names no struct, it is whatever the surroundings want
+	auto want = expected;
+	if (want == nullptr || want->type != TypeAST::Type::_struct ||
+		want->resolved_name == nullptr) {
+		for (auto v : it.values)
+			infer(*v, nullptr);
+		error(it,
+			  want ? fmt::format("expected {}, found a struct literal",
+								 want->spelling())
+				   : "cannot tell which struct the literal builds",
+			  "E0323");
+		return;
+	}
+
+	auto &members = want->resolved_name->members;
+	std::vector<bool> given(members.size());
+	it.fields.clear();
+	for (size_t i = 0; i < it.values.size(); i++) {
+		auto field = member(*want, it.names[i]);
+		it.fields.push_back(field);
+		if (field == members.size()) {
+			infer(*it.values[i], nullptr);
+			error(*it.values[i],
+				  fmt::format("{} has no member `{}`", want->spelling(),
+							  it.names[i]),
+				  "E0324");
+			continue;
+		}
+
+		if (given[field])
+			error(*it.values[i],
+				  fmt::format("`{}` is given more than once", it.names[i]),
+				  "E0325");
+		given[field] = true;
+		check(*it.values[i], members[field]->value.get());
+	}
+
+	for (size_t i = 0; i < members.size(); i++)
+		if (!given[i])
+			error(it,
+				  fmt::format("missing member `{}` of {}", members[i]->name,
+							  want->spelling()),
+				  "E0326");
+	it.checked_type = want;
+}
+
+void TypeCheck::visit(StructMemberAccessAST &it) {
+	infer(*it.parent, nullptr);
+	deref(it.parent);
+
+	auto type = it.parent->checked_type;
+	if (type == nullptr) return;
+	if (type->type != TypeAST::Type::_struct ||
+		type->resolved_name == nullptr) {
+		error(*it.parent,
+			  fmt::format("{} has no members", type->spelling()), "E0327");
+		return;
+	}
+
+	it.index = member(*type, it.name);
+	auto &members = type->resolved_name->members;
+	if (it.index == members.size()) {
+		error(it,
+			  fmt::format("{} has no member `{}`", type->spelling(), it.name),
+			  "E0324");
+		return;
+	}
+	it.checked_type = members[it.index]->value.get();
+}
+
+void TypeCheck::visit(LayoutExprAST &it) {
+	// like a literal, the constant takes whatever integer type is wanted
+	auto want = expected;
+	it.checked_type = want != nullptr && want->isInteger()
+						  ? want
+						  : TypeAST::builtin(TypeAST::Type::u64);
+	if (it.query != LayoutExprAST::Query::Offset) return;
+
+	auto &type = *it.type;
+	if (type.type != TypeAST::Type::_struct || type.resolved_name == nullptr) {
+		error(it, fmt::format("{} has no members", type.spelling()), "E0327");
+		return;
+	}
+	it.index = member(type, it.member);
+	if (it.index == type.resolved_name->members.size())
+		error(it,
+			  fmt::format("{} has no member `{}`", type.spelling(), it.member),
+			  "E0324");
+}
+
+void TypeCheck::visit(ArrayLiteralAST &it) {
+	using T = TypeAST::Type;
+	auto want = expected;
+	if (want != nullptr && (want->type == T::array || want->isVector())) {
+		if (it.elements.size() != want->length)
+			error(it,
+				  fmt::format("expected {} elements, found {}", want->length,
+							  it.elements.size()),
+				  "E0307");
+
+		for (auto e : it.elements)
+			check(*e, want->child.value().get());
+		it.checked_type = want;
+		return;
+	}
+
+	// nothing around the literal says what it holds, the first element
+	// decides for the rest
+	if (it.elements.empty()) {
+		error(it, "cannot tell what an empty array holds", "E0308");
+		return;
+	}
+
+	infer(*it.elements.front(), nullptr);
+	auto element = it.elements.front()->checked_type;
+	if (element == nullptr) return;
+	for (size_t i = 1; i < it.elements.size(); i++)
+		check(*it.elements[i], element);
+
+	it.inferred = std::make_shared<TypeAST>(
+		T::array, std::make_shared<TypeAST>(*element), "");
+	it.inferred->length = it.elements.size();
+	it.inferred->loc = it.loc;
+	it.checked_type = it.inferred.get();
+}
+
+void TypeCheck::visit(IndexExprAST &it) {
+	infer(*it.array, nullptr);
+	infer(*it.index, nullptr);
+	deref(it.array);
+
+	auto array = it.array->checked_type, index = it.index->checked_type;
+	if (array == nullptr || index == nullptr) return;
+
+	if (array->type != TypeAST::Type::array && !array->isVector()) {
+		error(*it.array,
+			  fmt::format("cannot index into {}", array->spelling()), "E0309");
+		return;
+	}
+	if (!index->isInteger()) {
+		error(*it.index,
+			  fmt::format("an index must be an integer, found {}",
+						  index->spelling()),
+			  "E0310");
+		return;
+	}
+
+	// a literal index can be checked now rather than when the program runs
+	if (auto number = dynamic_cast<NumberExprAST *>(it.index.get())) {
+		llvm::APInt value;
+		if (!llvm::StringRef(number->value).getAsInteger(10, value) &&
+			value.uge(array->length))
+			error(*it.index,
+				  fmt::format("index {} is out of bounds for {}",
+							  number->value, array->spelling()),
+				  "E0311");
+	}
+
+	it.checked_type = array->child.value().get();
+}
+
+// the packed struct `place` is a member of, if any
+static StructAST *packed(ExprAST &place) {
+	auto node = &place;
+	while (true) {
+		if (auto index = dynamic_cast<IndexExprAST *>(node)) {
+			node = index->array.get();
+			continue;
+		}
+		auto member = dynamic_cast<StructMemberAccessAST *>(node);
+		if (member == nullptr) return nullptr;
+
+		node = member->parent.get();
+		auto type = node->checked_type;
+		if (type != nullptr && type->resolved_name != nullptr &&
+			type->resolved_name->attribute("packed"))
+			return type->resolved_name;
+	}
+}
+
+void TypeCheck::visit(RefExprAST &it) {
+	using T = TypeAST::Type;
+	auto want = expected;
+	infer(*it.target,
+		  want && want->type == T::pointer ? want->child.value().get()
+										   : nullptr);
+
+	// only something with a place in memory can be pointed to
+	ExprAST *node = IndexExprAST::base(*it.target);
+	if (dynamic_cast<VariableExprAST *>(node) == nullptr &&
+		dynamic_cast<DerefExprAST *>(node) == nullptr) {
+		error(it,
+			  "can only take a reference to a variable or an element or member "
+			  "of one",
+			  "E0318");
+		return;
+	}
+	if (it.mut) writable(it, *it.target);
+	if (auto s = packed(*it.target)) {
+		error(it,
+			  fmt::format("cannot take a reference to a member of {}, which "
+						  "is packed and may not be aligned",
+						  s->name),
+			  "E0329");
+		return;
+	}
+
+	auto type = it.target->checked_type;
+	if (type == nullptr) return;
+	it.inferred = std::make_shared<TypeAST>(
+		T::pointer, std::make_shared<TypeAST>(*type), "&");
+	it.inferred->mut = it.mut;
+	it.inferred->loc = it.loc;
+	it.checked_type = it.inferred.get();
+}
+
+void TypeCheck::visit(DerefExprAST &it) {
+	infer(*it.pointer, nullptr);
+	auto type = it.pointer->checked_type;
+	if (type == nullptr) return;
+
+	if (type->type != TypeAST::Type::pointer) {
+		error(*it.pointer,
+			  fmt::format("cannot dereference {}", type->spelling()), "E0319");
+		return;
+	}
+	it.checked_type = type->child.value().get();
+}
+
+void TypeCheck::deref(std::shared_ptr<ExprAST> &expr) {
+	auto type = expr->checked_type;
+	if (type == nullptr || type->type != TypeAST::Type::pointer) return;
+
+	auto loc = expr->loc;
+	expr = std::make_shared<DerefExprAST>(std::move(expr));
+	expr->loc = loc;
+	expr->checked_type = type->child.value().get();
+}
+
+void TypeCheck::writable(AST &at, ExprAST &target) {
+	auto deref = dynamic_cast<DerefExprAST *>(IndexExprAST::base(target));
+	if (deref == nullptr) return;
+	auto type = deref->pointer->checked_type;
+	if (type == nullptr || type->mut) return;
+	error(at,
+		  fmt::format("cannot write through {}, it is not `&mut`",
+					  type->spelling()),
+		  "E0320");
+}
+
+void TypeCheck::visit(VariableExprAST &it) {
+	if (auto decl = dynamic_cast<VarDecl *>(it.resolved_name))
+		it.checked_type = decl->type.get();
+	else if (auto param = dynamic_cast<ParameterAST *>(it.resolved_name))
+		it.checked_type = param->type.get();
 }
 
-void TypeCheck::visit(VariableExprAST &it) {}
 void TypeCheck::visit(FileAST &it) {
 	for (auto c : it.expressions)
 		c->accept(*this);
 }
 
-void TypeCheck::visit(ParameterAST &it) {}
-void TypeCheck::visit(FunctionAST &it) {}
-void TypeCheck::visit(PrototypeAST &it) {}
-void TypeCheck::visit(ExprStmt &it) {}
-void TypeCheck::visit(ReturnStmt &it) {}
-void TypeCheck::visit(IfStmt &it) {}
-void TypeCheck::visit(WhileStmt &it) {}
-void TypeCheck::visit(VarDecl &it) {}
-void TypeCheck::visit(TypeAST &it) {}
-void TypeCheck::visit(StructMemberAST &it) {}
-void TypeCheck::visit(StructAST &it) {}
+void TypeCheck::visit(ParameterAST &) {}
+
+void TypeCheck::visit(FunctionAST &it) {
+	if (auto a = it.proto->attribute("fp_mode")) {
+		bool known = a->args.size() == 1 &&
+					 IR::Generator::parseFPMode(a->args[0].value);
+		if (!known)
+			error(a->loc,
+				  "`fp_mode` takes one of \"strict\", \"contract\" or "
+				  "\"fast\"",
+				  "E0304");
+	}
+
+	if (auto a = it.proto->attribute("target_clones")) {
+		bool fallback = false;
+		for (auto &arg : a->args) {
+			if (arg.value == "default") {
+				fallback = true;
+				continue;
+			}
+			auto &targets = IR::Generator::cloneTargets();
+			bool known = std::any_of(
+				targets.begin(), targets.end(),
+				[&](auto &target) { return target.name == arg.value; });
+			if (!known)
+				error(a->loc,
+					  fmt::format("`target_clones` cannot make a version for "
+								  "`{}`",
+								  arg.value),
+					  "E0305");
+		}
+		if (!fallback)
+			error(a->loc, "`target_clones` needs a \"default\" version",
+				  "E0306");
+	}
+
+	flag(*it.proto, "cold");
+
+	function = it.proto.get();
+	it.body->accept(*this);
+	function = nullptr;
+}
+
+void TypeCheck::visit(PrototypeAST &) {}
+
+void TypeCheck::visit(ExprStmt &it) { infer(*it.value, nullptr); }
+
+void TypeCheck::visit(AssignStmt &it) {
+	infer(*it.target, nullptr);
+	writable(it, *it.target);
+	check(*it.value, it.target->checked_type);
+}
+
+void TypeCheck::visit(ReturnStmt &it) {
+	if (it.value && function != nullptr)
+		check(*it.value.value(), function->retType.get());
+}
+
+void TypeCheck::visit(IfStmt &it) {
+	check(*it.condition, TypeAST::builtin(TypeAST::Type::_bool));
+	flag(*it.block, "cold");
+	it.block->accept(*this);
+	if (it.else_) {
+		flag(*it.else_.value(), "cold");
+		it.else_.value()->accept(*this);
+	}
+}
+
+void TypeCheck::flag(AST &node, std::string_view name) {
+	auto a = node.attribute(name);
+	if (a != nullptr && !a->args.empty())
+		error(a->loc, fmt::format("`{}` takes no arguments", name), "E0317");
+}
+
+void TypeCheck::alignment(AST &node) {
+	auto a = node.attribute("align");
+	if (a != nullptr && !IR::Generator::parseAlign(*a))
+		error(a->loc, "`align` takes one power of two", "E0328");
+}
+
+void TypeCheck::loopHints(AST &loop) {
+	for (auto &a : loop.attributes) {
+		if (a.name != "vectorize" && a.name != "unroll" &&
+			a.name != "interleave")
+			continue;
+		if (IR::Generator::parseLoopHint(a)) continue;
+
+		if (a.name == "vectorize")
+			error(a.loc, "`vectorize` takes `width=N` or `disable`", "E0314");
+		else if (a.name == "unroll")
+			error(a.loc, "`unroll` takes a count, `full` or `disable`",
+				  "E0314");
+		else
+			error(a.loc, "`interleave` takes a count or `disable`", "E0314");
+	}
+}
+
+void TypeCheck::visit(WhileStmt &it) {
+	loopHints(it);
+	check(*it.condition, TypeAST::builtin(TypeAST::Type::_bool));
+	it.block->accept(*this);
+}
+
+void TypeCheck::visit(ForStmt &it) {
+	using T = TypeAST::Type;
+	loopHints(it);
+	auto &variable = *it.variable;
+
+	if (it.array) {
+		infer(*it.array, nullptr);
+		deref(it.array);
+		auto array = it.array->checked_type;
+		if (array != nullptr && array->type != T::array) {
+			error(*it.array,
+				  fmt::format("cannot iterate over {}", array->spelling()),
+				  "E0309");
+		} else if (array != nullptr) {
+			auto element = array->child.value();
+			if (variable.type == nullptr)
+				variable.type = element;
+			else if (*variable.type != *element)
+				error(variable,
+					  fmt::format("expected {}, found {}",
+								  variable.type->spelling(),
+								  element->spelling()),
+					  "E0300");
+		}
+		it.block->accept(*this);
+		return;
+	}
+
+	// like a binary operator, a literal bound takes the type of the other, or
+	// of the step when both are literals
+	TypeAST *want = variable.type.get();
+	if (want == nullptr && is_literal(*it.start) && is_literal(*it.end) &&
+		it.step && !is_literal(*it.step.value())) {
+		infer(*it.step.value(), nullptr);
+		want = it.step.value()->checked_type;
+		check(*it.start, want);
+		check(*it.end, want);
+	} else if (want == nullptr && is_literal(*it.end)) {
+		infer(*it.start, nullptr);
+		want = it.start->checked_type;
+		check(*it.end, want);
+	} else if (want == nullptr) {
+		infer(*it.end, nullptr);
+		want = it.end->checked_type;
+		check(*it.start, want);
+	} else {
+		check(*it.start, want);
+		check(*it.end, want);
+	}
+	if (it.step && it.step.value()->checked_type == nullptr)
+		check(*it.step.value(), want);
+
+	if (want != nullptr && !want->isInteger()) {
+		error(it,
+			  fmt::format("a range has to be of integers, found {}",
+						  want->spelling()),
+			  "E0315");
+	} else if (want != nullptr) {
+		auto number = it.step ? dynamic_cast<NumberExprAST *>(
+									it.step.value().get())
+							  : nullptr;
+		llvm::APInt value;
+		if (number != nullptr &&
+			!llvm::StringRef(number->value).getAsInteger(10, value) &&
+			value.isZero())
+			error(*number, "the step of a range has to be positive", "E0316");
+		if (variable.type == nullptr)
+			variable.type = std::make_shared<TypeAST>(*want);
+	}
+
+	it.block->accept(*this);
+}
+
+void TypeCheck::visit(VarDecl &it) {
+	// a reference that can be pointed somewhere else would hide which
+	// variable it is a reference to
+	if (it.mut && it.type->type == TypeAST::Type::pointer)
+		error(it, "a reference cannot be `let mut`", "E0322");
+	if (it.value) check(*it.value.value(), it.type.get());
+}
+
+void TypeCheck::visit(TypeAST &) {}
+void TypeCheck::visit(StructMemberAST &it) {
+	alignment(it);
+	flag(it, "hot");
+}
+
+void TypeCheck::visit(StructAST &it) {
+	flag(it, "packed");
+	alignment(it);
+	// the only layout there is to ask for is the one C would use
+	auto repr = it.attribute("repr");
+	if (repr != nullptr &&
+		(repr->args.size() != 1 || !repr->args[0].key.empty() ||
+		 repr->args[0].value != "C"))
+		error(repr->loc, "`repr` only takes `C`", "E0330");
+	for (auto &member : it.members)
+		member->accept(*this);
+}
 } // namespace FoxLang
@@ -1,14 +1,18 @@
 #pragma once
 
+#include "ast_nodes.hpp"
 #include "ast_pass.hpp"
+#include "diagnostics.hpp"
+
 namespace FoxLang {
+/// TypeCheck - Works out the type of every expression and stores it in
+/// ExprAST::checked_type, so code generation can tell `i32` from `u32`.
+/// Unsized literals take the type of what they are combined with or stored
+/// into, and fall back to i32 (or f64) when nothing says otherwise. Runs
+/// after name resolution.
 class TypeCheck : public ASTVisitor {
 public:
-	TypeAST *current_type;
-	TypeAST *expr_type;
-	TypeAST::Type lit_type;
-	const static TypeAST::Type null = (TypeAST::Type)0;
-	const static TypeAST::Type error = (TypeAST::Type)1;
+	TypeCheck(Diagnostics &diagnostics) : diagnostics(diagnostics) {}
 
 	virtual void visit(BlockAST &it);
 	virtual void visit(BinaryExprAST &it);
@@ -17,52 +21,58 @@ public:
 	virtual void visit(StringLiteralAST &it);
 	virtual void visit(BoolLiteralAST &it);
 	virtual void visit(StructLiteralAST &it);
+	virtual void visit(ArrayLiteralAST &it);
 	virtual void visit(VariableExprAST &it);
+	virtual void visit(IndexExprAST &it);
+	virtual void visit(RefExprAST &it);
+	virtual void visit(DerefExprAST &it);
+	virtual void visit(StructMemberAccessAST &it);
+	virtual void visit(LayoutExprAST &it);
 	virtual void visit(FileAST &it);
 	virtual void visit(ParameterAST &it);
 	virtual void visit(FunctionAST &it);
 	virtual void visit(PrototypeAST &it);
 	virtual void visit(ExprStmt &it);
+	virtual void visit(AssignStmt &it);
 	virtual void visit(ReturnStmt &it);
 	virtual void visit(IfStmt &it);
 	virtual void visit(WhileStmt &it);
+	virtual void visit(ForStmt &it);
 	virtual void visit(VarDecl &it);
 	virtual void visit(TypeAST &it);
 	virtual void visit(StructMemberAST &it);
 	virtual void visit(StructAST &it);
 
-	inline void compare_lit_types(TypeAST::Type left_lit,
-								  TypeAST::Type right_lit) {
-		using T = TypeAST::Type;
-		if (left_lit == T::_bool && right_lit == T::_bool) lit_type = T::_bool;
-		if (left_lit == T::__float && right_lit == T::__float)
-			lit_type = T::__float;
-		if ((left_lit == T::__int && right_lit == T::__int) ||
-			(left_lit == T::__uint && right_lit == T::__int) ||
-			(left_lit == T::__int && right_lit == T::__uint))
-			lit_type = T::__int;
-		if (left_lit == T::__uint && right_lit == T::__uint)
-			lit_type = T::__uint;
-		if (lit_type == null) {
-			lit_type = error;
-			std::cout << "Types not equal" << std::endl;
-		}
-	}
+private:
+	Diagnostics &diagnostics;
 
-	inline void compare_lit_types(TypeAST &type, TypeAST::Type lit) {
-		using T = TypeAST::Type;
-		if (type.type == T::_bool && lit == T::_bool) {
-			expr_type = &type;
-			return;
-		}
-	}
+	// prototype of the function being checked, for return statements
+	PrototypeAST *function = nullptr;
+	// the type the surrounding code wants the current expression to have
+	TypeAST *expected = nullptr;
 
-	inline void compare_lit_types(TypeAST &left, TypeAST::Type left_lit,
-								  TypeAST &right, TypeAST::Type right_lit) {
-		if (left_lit == null)
-			compare_lit_types(left, right_lit);
-		else
-			compare_lit_types(right, left_lit);
-	}
+	/// Checks `expr` wanting `want`, and reports it when the type it ends up
+	/// with is a different one
+	void check(ExprAST &expr, TypeAST *want);
+	void infer(ExprAST &expr, TypeAST *want);
+	void builtin(CallExprAST &it);
+	/// Reports loop hint attributes on `loop` that are malformed
+	void loopHints(AST &loop);
+	/// Reports the attribute `name` on `node` if it is given arguments
+	void flag(AST &node, std::string_view name);
+	/// Reports an `align` attribute on `node` that is not a power of two
+	void alignment(AST &node);
+	/// Puts a DerefExprAST in front of `expr` when it is a reference, for
+	/// the places that look through one
+	void deref(std::shared_ptr<ExprAST> &expr);
+	/// Reports writing to `target` through a reference that is not `&mut`
+	void writable(AST &at, ExprAST &target);
+	/// Reports a reference argument to a `&mut` parameter that may overlap
+	/// another reference argument
+	void exclusive(CallExprAST &call, PrototypeAST &proto);
+	/// The type of `arg` to `call`, reported unless it is a vector
+	TypeAST *vector(CallExprAST &call, ExprAST &arg);
+	void error(AST &node, std::string message, std::string code);
+	void error(SourceLoc loc, std::string message, std::string code);
 };
 } // namespace FoxLang